@@ -0,0 +1,58 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Helpers shared by the benchmarks. A case runs once to warm up and then repeats times,
+// the fastest, median and slowest runs are printed in milliseconds.
+namespace bench
+{
+
+    // Results of the measured tasks are added up here so that the compiler keeps the work.
+    inline volatile size_t sink = 0;
+
+    // task returns a value convertible to size_t, e.g. the size of what it has built.
+    // Returns the median time in milliseconds.
+    template <typename Task>
+    double Measure(std::string_view name, size_t repeats, Task&& task)
+    {
+        using Clock = std::chrono::steady_clock;
+        sink = sink + static_cast<size_t>(task());
+        std::vector<double> times;
+        times.reserve(repeats);
+        for (size_t i = 0; i < repeats; ++i)
+        {
+            const auto start = Clock::now();
+            sink = sink + static_cast<size_t>(task());
+            times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        const double median = times.empty() ? 0. : times[times.size() / 2];
+        if (!times.empty())
+        {
+            std::cout << name << ": min " << times.front() << " ms, median " << median
+                << " ms, max " << times.back() << " ms" << std::endl;
+        }
+        return median;
+    }
+
+    inline std::string ReadFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        std::ostringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+}  // namespace bench
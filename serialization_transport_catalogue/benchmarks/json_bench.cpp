@@ -0,0 +1,113 @@
+// Compares the stream loaders of json.cpp with the buffer and the chunked ones on an
+// examples/ input repeated scale times in one array.
+//
+// usage: json_bench [input.json] [scale] [repeats]
+#include "bench_util.h"
+#include "json.h"
+
+#include <cstdlib>
+
+namespace
+{
+
+    // Counts the events of a value without building nodes.
+    class EventCounter final : public json::Handler
+    {
+    public:
+        void StartDict() override
+        {
+            ++count_;
+        }
+
+        void EndDict() override
+        {
+            ++count_;
+        }
+
+        void StartArray() override
+        {
+            ++count_;
+        }
+
+        void EndArray() override
+        {
+            ++count_;
+        }
+
+        void Key(std::string&&) override
+        {
+            ++count_;
+        }
+
+        void Value(json::Node&&) override
+        {
+            ++count_;
+        }
+
+        size_t GetCount() const noexcept
+        {
+            return count_;
+        }
+
+    private:
+        size_t count_ = 0;
+    };
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    const std::string path = argc > 1 ? argv[1] : "examples/s14_3_opentest_3_make_base.json";
+    const size_t scale = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+    const size_t repeats = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 5;
+
+    const std::string input = bench::ReadFile(path);
+    std::string scaled = "[";
+    for (size_t i = 0; i < scale; ++i)
+    {
+        scaled += i == 0 ? "" : ",";
+        scaled += input;
+    }
+    scaled += "]";
+    std::cout << path << " x " << scale << ": " << scaled.size() / (1024. * 1024.) << " MB" << std::endl;
+
+    {
+        std::istringstream in(scaled);
+        if (!(json::Load(in) == json::Load(std::string_view(scaled))))
+        {
+            std::cerr << "The stream and the buffer loaders give different documents" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    bench::Measure("Load, stream", repeats, [&scaled]
+        {
+            std::istringstream in(scaled);
+            return json::Load(in).GetRoot().AsArray().size();
+        });
+    bench::Measure("Load, buffer", repeats, [&scaled]
+        {
+            return json::Load(std::string_view(scaled)).GetRoot().AsArray().size();
+        });
+    bench::Measure("LoadEvents, stream", repeats, [&scaled]
+        {
+            std::istringstream in(scaled);
+            EventCounter counter;
+            json::LoadEvents(in, counter);
+            return counter.GetCount();
+        });
+    bench::Measure("LoadEvents, buffer", repeats, [&scaled]
+        {
+            EventCounter counter;
+            json::LoadEvents(std::string_view(scaled), counter);
+            return counter.GetCount();
+        });
+    bench::Measure("LoadEventsInChunks, stream", repeats, [&scaled]
+        {
+            std::istringstream in(scaled);
+            EventCounter counter;
+            json::LoadEventsInChunks(in, counter);
+            return counter.GetCount();
+        });
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+// Compares the bounding box and the projector of the map built the way SetSphereProjector
+// did before, by removing repeated coordinates with std::find, with the build over distinct
+// stops of MapRenderer::GetRouteStops, on a random catalogue.
+//
+// usage: map_bench [stop_count] [bus_count] [stops_per_bus] [seed] [repeats]
+#include "bench_util.h"
+#include "map_renderer.h"
+
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+
+    constexpr double WIDTH = 1200.;
+    constexpr double HEIGHT = 1200.;
+    constexpr double PADDING = 50.;
+
+    // Stops spread over a square degree, buses going through random stops and back, as
+    // json_reader gives them for "is_roundtrip": false.
+    std::vector<domain::BaseRequest> MakeRequests(size_t stop_count, size_t bus_count, size_t stops_per_bus, unsigned seed)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> offset(0., 1.);
+        std::uniform_int_distribution<size_t> stop(0, stop_count - 1);
+
+        std::vector<domain::BaseRequest> requests;
+        requests.reserve(stop_count + bus_count);
+        for (size_t i = 0; i < stop_count; ++i)
+        {
+            domain::BaseRequest request;
+            request.type = "Stop";
+            request.name_stop = "S" + std::to_string(i);
+            request.latitude = 43. + offset(generator);
+            request.longitude = 39. + offset(generator);
+            requests.push_back(std::move(request));
+        }
+        for (size_t i = 0; i < bus_count && stops_per_bus > 0; ++i)
+        {
+            domain::BaseRequest request;
+            request.type = "Bus";
+            request.name_bus = "B" + std::to_string(i);
+            for (size_t j = 0; j < stops_per_bus; ++j)
+            {
+                request.stops_for_bus.push_back("S" + std::to_string(stop(generator)));
+            }
+            request.name_last_stop = request.stops_for_bus.back();
+            request.stops_for_bus.reserve(stops_per_bus * 2 - 1);
+            request.stops_for_bus.insert(request.stops_for_bus.end(),
+                std::next(request.stops_for_bus.rbegin()), request.stops_for_bus.rend());
+            requests.push_back(std::move(request));
+        }
+        return requests;
+    }
+
+    // The coordinates of the stops with the repeated ones removed by std::find, and the
+    // extremes of them found by minmax_element as SetSphereProjector did before.
+    sphere_projector::BoundingBox MakeLegacyBox(const transport_catalogue::TransportCatalogue& tc)
+    {
+        std::vector<geo::Coordinates> coordinates;
+        for (const auto& bus : tc.GetRoute())
+        {
+            for (const auto& stop : bus.stops)
+            {
+                if (stop && std::find(coordinates.begin(), coordinates.end(), stop->coordinates) == coordinates.end())
+                {
+                    coordinates.push_back(stop->coordinates);
+                }
+            }
+        }
+        sphere_projector::BoundingBox box;
+        if (coordinates.empty())
+        {
+            return box;
+        }
+        const auto [left_it, right_it] = std::minmax_element(coordinates.begin(), coordinates.end(),
+            [](geo::Coordinates lhs, geo::Coordinates rhs) { return lhs.lng < rhs.lng; });
+        const auto [bottom_it, top_it] = std::minmax_element(coordinates.begin(), coordinates.end(),
+            [](geo::Coordinates lhs, geo::Coordinates rhs) { return lhs.lat < rhs.lat; });
+        box.min_lon = left_it->lng;
+        box.max_lon = right_it->lng;
+        box.min_lat = bottom_it->lat;
+        box.max_lat = top_it->lat;
+        box.empty = false;
+        return box;
+    }
+
+    sphere_projector::BoundingBox MakeBox(const transport_catalogue::TransportCatalogue& tc)
+    {
+        sphere_projector::BoundingBox box;
+        for (const transport_catalogue::StopPtr stop : renderer::MapRenderer::GetRouteStops(tc))
+        {
+            box.Extend(stop->coordinates);
+        }
+        return box;
+    }
+
+    bool IsSameBox(const sphere_projector::BoundingBox& lhs, const sphere_projector::BoundingBox& rhs)
+    {
+        return lhs.empty == rhs.empty && lhs.min_lon == rhs.min_lon && lhs.max_lon == rhs.max_lon
+            && lhs.min_lat == rhs.min_lat && lhs.max_lat == rhs.max_lat;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    const size_t stop_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    const size_t bus_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+    const size_t stops_per_bus = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 50;
+    const unsigned seed = argc > 4 ? static_cast<unsigned>(std::strtoul(argv[4], nullptr, 10)) : 7;
+    const size_t repeats = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 3;
+    if (stop_count == 0)
+    {
+        std::cerr << "The catalogue needs at least one stop" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const transport_catalogue::TransportCatalogue tc(MakeRequests(stop_count, bus_count, stops_per_bus, seed));
+    std::cout << tc.GetStopCount() << " stops, " << tc.GetBusCount() << " buses of "
+        << stops_per_bus << " stops there and back" << std::endl;
+
+    if (!IsSameBox(MakeLegacyBox(tc), MakeBox(tc)))
+    {
+        std::cerr << "The legacy and the new bounding boxes differ" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const double legacy_time = bench::Measure("std::find dedup + minmax_element", repeats, [&tc]
+        {
+            const sphere_projector::SphereProjector projector(MakeLegacyBox(tc), WIDTH, HEIGHT, PADDING);
+            return sizeof(projector);
+        });
+    const double time = bench::Measure("GetRouteStops + BoundingBox", repeats, [&tc]
+        {
+            const sphere_projector::SphereProjector projector(MakeBox(tc), WIDTH, HEIGHT, PADDING);
+            return sizeof(projector);
+        });
+    std::cout << "    speedup " << legacy_time / time << std::endl;
+    return EXIT_SUCCESS;
+}
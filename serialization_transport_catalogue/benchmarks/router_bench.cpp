@@ -0,0 +1,90 @@
+// Compares the serial all-pairs route table of graph::Router with the one built on a thread
+// pool, for several thread counts, on a random graph.
+//
+// usage: router_bench [vertex_count] [edges_per_vertex] [repeats] [thread_count...]
+// thread counts are 1, 2, 4 and 8 by default, 0 is the number of hardware threads.
+#include "bench_util.h"
+#include "router.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace
+{
+
+    using Graph = graph::DirectedWeightedGraph<double>;
+    using Router = graph::Router<double>;
+
+    Graph MakeGraph(size_t vertex_count, size_t edges_per_vertex)
+    {
+        std::mt19937 generator(7);
+        std::uniform_int_distribution<size_t> vertex(0, vertex_count - 1);
+        std::uniform_real_distribution<double> weight(1., 100.);
+        Graph graph(vertex_count);
+        for (graph::VertexId from = 0; from < vertex_count; ++from)
+        {
+            for (size_t i = 0; i < edges_per_vertex; ++i)
+            {
+                graph.AddEdge({ from, vertex(generator), weight(generator) });
+            }
+        }
+        return graph;
+    }
+
+    bool IsSameTable(const Router& lhs, const Router& rhs)
+    {
+        const auto lhs_data = lhs.GetRouterData();
+        const auto rhs_data = rhs.GetRouterData();
+        const size_t size = lhs_data.end() - lhs_data.begin();
+        return size == static_cast<size_t>(rhs_data.end() - rhs_data.begin())
+            && std::memcmp(lhs_data.begin(), rhs_data.begin(), size * sizeof(Router::RouteInternalData)) == 0;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    const size_t vertex_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    const size_t edges_per_vertex = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+    const size_t repeats = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 3;
+    std::vector<size_t> thread_counts;
+    for (int i = 4; i < argc; ++i)
+    {
+        thread_counts.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (thread_counts.empty())
+    {
+        thread_counts = { 1, 2, 4, 8 };
+    }
+
+    const Graph graph = MakeGraph(vertex_count, edges_per_vertex);
+    std::cout << vertex_count << " vertices, " << graph.GetEdgeCount() << " edges, "
+        << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+    const Router serial(graph);
+    const double serial_time = bench::Measure("Router(graph)", repeats, [&graph]
+        {
+            const Router router(graph);
+            return router.GetRouterData().end() - router.GetRouterData().begin();
+        });
+
+    for (const size_t thread_count : thread_counts)
+    {
+        thread_pool::ThreadPool pool(thread_count);
+        if (!IsSameTable(serial, Router(graph, pool)))
+        {
+            std::cerr << "Tables of Router(graph) and Router(graph, pool) differ" << std::endl;
+            return EXIT_FAILURE;
+        }
+        const double time = bench::Measure("Router(graph, pool), " + std::to_string(pool.GetThreadCount()) + " threads", repeats
+            , [&graph, &pool]
+            {
+                const Router router(graph, pool);
+                return router.GetRouterData().end() - router.GetRouterData().begin();
+            });
+        std::cout << "    speedup " << serial_time / time << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,563 @@
+#pragma once
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph
+{
+
+    // Contraction hierarchy over a DirectedWeightedGraph. Vertices are contracted one by one
+    // in the order of their importance, shortcuts keep the distances between the remaining
+    // vertices, and BuildRoute runs two upward searches that meet at the highest vertex of the route.
+    template <typename Weight>
+    class ContractionHierarchy
+    {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using RouteInfo = typename Router<Weight>::RouteInfo;
+
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        // An edge of the hierarchy: either an edge of the original graph (first is its id)
+        // or a shortcut made of two hierarchy edges first and second.
+        struct HierarchyEdge
+        {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first;
+            EdgeId second = NO_EDGE;
+        };
+
+        // Edges of one search direction grouped by vertex: edges of vertex v are
+        // edges[offsets[v]] .. edges[offsets[v + 1] - 1].
+        struct SearchGraph
+        {
+            std::vector<size_t> offsets;
+            std::vector<EdgeId> edges;
+        };
+
+        explicit ContractionHierarchy(const Graph& graph);
+
+        ContractionHierarchy(const Graph& graph, std::vector<HierarchyEdge>&& edges
+            , SearchGraph&& upward, SearchGraph&& downward);
+
+        const std::vector<HierarchyEdge>& GetEdges() const noexcept
+        {
+            return edges_;
+        }
+
+        const SearchGraph& GetUpwardGraph() const noexcept
+        {
+            return upward_;
+        }
+
+        const SearchGraph& GetDownwardGraph() const noexcept
+        {
+            return downward_;
+        }
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    private:
+        struct Label
+        {
+            Weight weight;
+            EdgeId prev_edge;
+        };
+        using SearchSpace = std::unordered_map<VertexId, Label>;
+        using QueueItem = std::pair<Weight, VertexId>;
+
+        // One direction of the bidirectional upward search.
+        struct Search
+        {
+            const SearchGraph& search_graph;
+            bool forward;
+            SearchSpace space{};
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue{};
+
+            void Start(VertexId start)
+            {
+                space[start] = { ZERO_WEIGHT, NO_EDGE };
+                queue.push({ ZERO_WEIGHT, start });
+            }
+
+            // Settles the nearest vertex, returns false when this direction can not improve the best route.
+            bool Settle(const ContractionHierarchy& hierarchy, const Search& other
+                , std::optional<Weight>& best_weight, VertexId& meeting_vertex);
+        };
+
+        class Contraction;
+
+        void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& route) const;
+
+        static constexpr Weight ZERO_WEIGHT{};
+
+        const Graph& graph_;
+        std::vector<HierarchyEdge> edges_;
+        SearchGraph upward_;
+        SearchGraph downward_;
+    };
+
+    // State needed only while the hierarchy is being built. Adjacency lists keep only
+    // the best edge to every neighbour that has not been contracted yet.
+    template <typename Weight>
+    class ContractionHierarchy<Weight>::Contraction
+    {
+    public:
+        static constexpr size_t WITNESS_SETTLE_LIMIT = 16;
+
+        Contraction(const Graph& graph, std::vector<HierarchyEdge>& edges)
+            : edges_(edges)
+            , vertex_count_(graph.GetVertexCount())
+            , out_(vertex_count_)
+            , in_(vertex_count_)
+            , upward_(vertex_count_)
+            , downward_(vertex_count_)
+            , contracted_(vertex_count_, false)
+            , contracted_neighbours_(vertex_count_, 0)
+            , direct_(vertex_count_, NO_ARC)
+            , witness_weights_(vertex_count_)
+            , target_weights_(vertex_count_)
+        {
+            for (VertexId from = 0; from < vertex_count_; ++from)
+            {
+                for (const EdgeId edge_id : graph.GetIncidentEdges(from))
+                {
+                    const auto& edge = graph.GetEdge(edge_id);
+                    if (edge.weight < ZERO_WEIGHT)
+                    {
+                        throw std::domain_error("Edges' weights should be non-negative");
+                    }
+                    if (edge.to == from)
+                    {
+                        continue;
+                    }
+                    if (direct_[edge.to] == NO_ARC)
+                    {
+                        direct_[edge.to] = out_[from].size();
+                        out_[from].push_back({ edge.to, edges_.size() });
+                        edges_.push_back({ from, edge.to, edge.weight, edge_id });
+                    }
+                    else if (edge.weight < edges_[out_[from][direct_[edge.to]].edge].weight)
+                    {
+                        edges_[out_[from][direct_[edge.to]].edge] = { from, edge.to, edge.weight, edge_id };
+                    }
+                }
+                for (const Arc& arc : out_[from])
+                {
+                    direct_[arc.vertex] = NO_ARC;
+                    in_[arc.vertex].push_back({ from, arc.edge });
+                }
+            }
+        }
+
+        void Run()
+        {
+            using QueueItem = std::pair<long long, VertexId>;
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex)
+            {
+                queue.push({ Priority(vertex), vertex });
+            }
+
+            while (!queue.empty())
+            {
+                const VertexId vertex = queue.top().second;
+                queue.pop();
+                const long long priority = Priority(vertex);
+                if (!queue.empty() && priority > queue.top().first)
+                {
+                    queue.push({ priority, vertex });
+                    continue;
+                }
+                ContractVertex(vertex, false);
+                RemoveVertex(vertex);
+            }
+        }
+
+        // Edges left to not yet contracted neighbours at the moment a vertex is contracted
+        // lead up the hierarchy: outgoing ones form the upward graph, incoming ones the downward graph.
+        void FillSearchGraphs(SearchGraph& upward, SearchGraph& downward) const
+        {
+            FillSearchGraph(upward_, upward);
+            FillSearchGraph(downward_, downward);
+        }
+
+    private:
+        struct Arc
+        {
+            VertexId vertex;
+            EdgeId edge;
+        };
+
+        static constexpr size_t NO_ARC = std::numeric_limits<size_t>::max();
+
+        static void FillSearchGraph(const std::vector<std::vector<EdgeId>>& lists, SearchGraph& search_graph)
+        {
+            search_graph.offsets.assign(1, 0);
+            search_graph.edges.clear();
+            for (const auto& list : lists)
+            {
+                search_graph.edges.insert(search_graph.edges.end(), list.begin(), list.end());
+                search_graph.offsets.push_back(search_graph.edges.size());
+            }
+        }
+
+        long long Priority(VertexId vertex)
+        {
+            const long long removed_edges = static_cast<long long>(out_[vertex].size() + in_[vertex].size());
+            const long long shortcuts = static_cast<long long>(ContractVertex(vertex, true));
+            return shortcuts - removed_edges + static_cast<long long>(contracted_neighbours_[vertex]);
+        }
+
+        // Returns the number of shortcuts needed to remove the vertex and adds them unless simulate is set.
+        // A simulation skips witness searches and only checks the direct edges, which is enough for ordering.
+        size_t ContractVertex(VertexId vertex, bool simulate)
+        {
+            size_t shortcut_count = 0;
+            for (size_t in_index = 0; in_index < in_[vertex].size(); ++in_index)
+            {
+                const Arc arc_in = in_[vertex][in_index];
+                const VertexId from = arc_in.vertex;
+                const Weight weight_in = edges_[arc_in.edge].weight;
+
+                for (size_t i = 0; i < out_[from].size(); ++i)
+                {
+                    direct_[out_[from][i].vertex] = i;
+                }
+                pending_.clear();
+                Weight max_weight = ZERO_WEIGHT;
+                for (const Arc& arc_out : out_[vertex])
+                {
+                    if (arc_out.vertex == from)
+                    {
+                        continue;
+                    }
+                    const Weight candidate_weight = weight_in + edges_[arc_out.edge].weight;
+                    const size_t direct = direct_[arc_out.vertex];
+                    if (direct != NO_ARC && edges_[out_[from][direct].edge].weight <= candidate_weight)
+                    {
+                        continue;
+                    }
+                    pending_.push_back({ arc_out, candidate_weight });
+                    max_weight = std::max(max_weight, candidate_weight);
+                }
+
+                if (simulate)
+                {
+                    shortcut_count += pending_.size();
+                }
+                else if (!pending_.empty())
+                {
+                    SearchWitnesses(from, vertex, max_weight);
+                    for (const auto& [arc_out, candidate_weight] : pending_)
+                    {
+                        if (!target_weights_[arc_out.vertex])
+                        {
+                            continue;
+                        }
+                        target_weights_[arc_out.vertex].reset();
+                        ++shortcut_count;
+                        AddShortcut({ from, arc_out.vertex, candidate_weight, arc_in.edge, arc_out.edge });
+                    }
+                }
+
+                for (const Arc& arc : out_[from])
+                {
+                    direct_[arc.vertex] = NO_ARC;
+                }
+            }
+            return shortcut_count;
+        }
+
+        // direct_ holds positions in out_[shortcut.from] while the shortcut is added.
+        void AddShortcut(const HierarchyEdge& shortcut)
+        {
+            const EdgeId edge_id = edges_.size();
+            edges_.push_back(shortcut);
+            const size_t direct = direct_[shortcut.to];
+            if (direct == NO_ARC)
+            {
+                direct_[shortcut.to] = out_[shortcut.from].size();
+                out_[shortcut.from].push_back({ shortcut.to, edge_id });
+                in_[shortcut.to].push_back({ shortcut.from, edge_id });
+                return;
+            }
+            out_[shortcut.from][direct].edge = edge_id;
+            for (Arc& arc : in_[shortcut.to])
+            {
+                if (arc.vertex == shortcut.from)
+                {
+                    arc.edge = edge_id;
+                    break;
+                }
+            }
+        }
+
+        void RemoveVertex(VertexId vertex)
+        {
+            contracted_[vertex] = true;
+            for (const Arc& arc : out_[vertex])
+            {
+                upward_[vertex].push_back(arc.edge);
+                EraseArc(in_[arc.vertex], vertex);
+                ++contracted_neighbours_[arc.vertex];
+            }
+            for (const Arc& arc : in_[vertex])
+            {
+                downward_[vertex].push_back(arc.edge);
+                EraseArc(out_[arc.vertex], vertex);
+                ++contracted_neighbours_[arc.vertex];
+            }
+            out_[vertex] = {};
+            in_[vertex] = {};
+        }
+
+        static void EraseArc(std::vector<Arc>& arcs, VertexId vertex)
+        {
+            for (auto it = arcs.begin(); it != arcs.end(); ++it)
+            {
+                if (it->vertex == vertex)
+                {
+                    *it = arcs.back();
+                    arcs.pop_back();
+                    return;
+                }
+            }
+        }
+
+        // Bounded Dijkstra over the remaining vertices that avoids the vertex being contracted.
+        // Targets whose witness is found are reset in target_weights_, the search stops when none are left.
+        void SearchWitnesses(VertexId from, VertexId ignored, Weight max_weight)
+        {
+            size_t targets_left = pending_.size();
+            for (const auto& [arc_out, candidate_weight] : pending_)
+            {
+                target_weights_[arc_out.vertex] = candidate_weight;
+            }
+
+            using QueueItem = std::pair<Weight, VertexId>;
+            for (const VertexId vertex : witness_touched_)
+            {
+                witness_weights_[vertex].reset();
+            }
+            witness_touched_.clear();
+
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+            witness_weights_[from] = ZERO_WEIGHT;
+            witness_touched_.push_back(from);
+            queue.push({ ZERO_WEIGHT, from });
+            size_t settled = 0;
+            while (!queue.empty() && settled < WITNESS_SETTLE_LIMIT)
+            {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (weight > *witness_weights_[vertex])
+                {
+                    continue;
+                }
+                if (weight > max_weight)
+                {
+                    break;
+                }
+                ++settled;
+                for (const Arc& arc : out_[vertex])
+                {
+                    if (arc.vertex == ignored)
+                    {
+                        continue;
+                    }
+                    const Weight candidate_weight = weight + edges_[arc.edge].weight;
+                    auto& weight_to = witness_weights_[arc.vertex];
+                    if (!weight_to || candidate_weight < *weight_to)
+                    {
+                        if (!weight_to)
+                        {
+                            witness_touched_.push_back(arc.vertex);
+                        }
+                        weight_to = candidate_weight;
+                        queue.push({ candidate_weight, arc.vertex });
+                        auto& target_weight = target_weights_[arc.vertex];
+                        if (target_weight && candidate_weight <= *target_weight)
+                        {
+                            target_weight.reset();
+                            if (--targets_left == 0)
+                            {
+                                return;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<HierarchyEdge>& edges_;
+        size_t vertex_count_;
+        std::vector<std::vector<Arc>> out_;
+        std::vector<std::vector<Arc>> in_;
+        std::vector<std::vector<EdgeId>> upward_;
+        std::vector<std::vector<EdgeId>> downward_;
+        std::vector<bool> contracted_;
+        std::vector<size_t> contracted_neighbours_;
+        std::vector<size_t> direct_;
+        std::vector<std::pair<Arc, Weight>> pending_;
+        std::vector<std::optional<Weight>> witness_weights_;
+        std::vector<VertexId> witness_touched_;
+        std::vector<std::optional<Weight>> target_weights_;
+    };
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+        : graph_(graph)
+    {
+        Contraction contraction(graph, edges_);
+        contraction.Run();
+        contraction.FillSearchGraphs(upward_, downward_);
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, std::vector<HierarchyEdge>&& edges
+        , SearchGraph&& upward, SearchGraph&& downward)
+        : graph_(graph)
+        , edges_(std::move(edges))
+        , upward_(std::move(upward))
+        , downward_(std::move(downward))
+    {}
+
+    template <typename Weight>
+    bool ContractionHierarchy<Weight>::Search::Settle(const ContractionHierarchy& hierarchy, const Search& other
+        , std::optional<Weight>& best_weight, VertexId& meeting_vertex)
+    {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > space.at(vertex).weight)
+        {
+            return true;
+        }
+        if (best_weight && !(weight < *best_weight))
+        {
+            return false;
+        }
+        if (const auto other_label = other.space.find(vertex); other_label != other.space.end())
+        {
+            const Weight route_weight = weight + other_label->second.weight;
+            if (!best_weight || route_weight < *best_weight)
+            {
+                best_weight = route_weight;
+                meeting_vertex = vertex;
+            }
+        }
+        for (size_t i = search_graph.offsets[vertex]; i < search_graph.offsets[vertex + 1]; ++i)
+        {
+            const EdgeId edge_id = search_graph.edges[i];
+            const auto& edge = hierarchy.edges_[edge_id];
+            const VertexId next = forward ? edge.to : edge.from;
+            const Weight candidate_weight = weight + edge.weight;
+            const auto [label, inserted] = space.insert({ next, { candidate_weight, edge_id } });
+            if (inserted || candidate_weight < label->second.weight)
+            {
+                label->second = { candidate_weight, edge_id };
+                queue.push({ candidate_weight, next });
+            }
+        }
+        return true;
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& route) const
+    {
+        std::vector<EdgeId> stack{ edge_id };
+        while (!stack.empty())
+        {
+            const auto& edge = edges_[stack.back()];
+            stack.pop_back();
+            if (edge.second == NO_EDGE)
+            {
+                route.push_back(edge.first);
+            }
+            else
+            {
+                stack.push_back(edge.second);
+                stack.push_back(edge.first);
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(VertexId from,
+        VertexId to) const
+    {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count)
+        {
+            return std::nullopt;
+        }
+        if (from == to)
+        {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+
+        Search forward{ upward_, true };
+        Search backward{ downward_, false };
+        forward.Start(from);
+        backward.Start(to);
+
+        // A direction stops once its nearest vertex is not closer than the best route found so far.
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = from;
+        bool forward_active = true;
+        bool backward_active = true;
+        while (forward_active || backward_active)
+        {
+            forward_active = forward_active && !forward.queue.empty();
+            backward_active = backward_active && !backward.queue.empty();
+            if (forward_active)
+            {
+                forward_active = forward.Settle(*this, backward, best_weight, meeting_vertex);
+            }
+            if (backward_active)
+            {
+                backward_active = backward.Settle(*this, forward, best_weight, meeting_vertex);
+            }
+        }
+        if (!best_weight)
+        {
+            return std::nullopt;
+        }
+        const SearchSpace& forward_space = forward.space;
+        const SearchSpace& backward_space = backward.space;
+
+        std::vector<EdgeId> upward_edges;
+        for (VertexId vertex = meeting_vertex; vertex != from; vertex = edges_[upward_edges.back()].from)
+        {
+            upward_edges.push_back(forward_space.at(vertex).prev_edge);
+        }
+        std::vector<EdgeId> edges;
+        for (auto it = upward_edges.rbegin(); it != upward_edges.rend(); ++it)
+        {
+            UnpackEdge(*it, edges);
+        }
+        for (VertexId vertex = meeting_vertex; vertex != to; )
+        {
+            const EdgeId edge_id = backward_space.at(vertex).prev_edge;
+            UnpackEdge(edge_id, edges);
+            vertex = edges_[edge_id].to;
+        }
+
+        return RouteInfo{ *best_weight, std::move(edges) };
+    }
+
+}  // namespace graph
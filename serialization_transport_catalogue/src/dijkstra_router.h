@@ -0,0 +1,109 @@
+#pragma once
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph
+{
+
+    // Router without any precomputation: every BuildRoute runs Dijkstra
+    // from the source vertex and stops as soon as the target is settled.
+    template <typename Weight>
+    class DijkstraRouter
+    {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+        using QueueItem = std::pair<Weight, VertexId>;
+
+    public:
+        using RouteInfo = typename Router<Weight>::RouteInfo;
+
+        explicit DijkstraRouter(const Graph& graph);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        const Graph& graph_;
+    };
+
+    template <typename Weight>
+    DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
+        : graph_(graph)
+    {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id)
+        {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT)
+            {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const
+    {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count)
+        {
+            return std::nullopt;
+        }
+
+        std::vector<std::optional<Weight>> weights(vertex_count);
+        std::vector<EdgeId> prev_edges(vertex_count, NO_EDGE);
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+        weights[from] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, from });
+        while (!queue.empty())
+        {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > *weights[vertex])
+            {
+                continue;
+            }
+            if (vertex == to)
+            {
+                break;
+            }
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex))
+            {
+                const auto& edge = graph_.GetEdge(edge_id);
+                const Weight candidate_weight = weight + edge.weight;
+                auto& weight_to = weights[edge.to];
+                if (!weight_to || candidate_weight < *weight_to)
+                {
+                    weight_to = candidate_weight;
+                    prev_edges[edge.to] = edge_id;
+                    queue.push({ candidate_weight, edge.to });
+                }
+            }
+        }
+
+        if (!weights[to])
+        {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (VertexId vertex = to; vertex != from; vertex = graph_.GetEdge(edges.back()).from)
+        {
+            edges.push_back(prev_edges[vertex]);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{ *weights[to], std::move(edges) };
+    }
+
+}  // namespace graph
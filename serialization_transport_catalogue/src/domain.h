@@ -36,10 +36,45 @@ namespace domain
 		NameStop to{};
 	};
 
+	enum class RouterMode
+	{
+		ALL_PAIRS,
+		DIJKSTRA,
+		CONTRACTION_HIERARCHY
+	};
+
+	// How bus routes are turned into the routing graph.
+	enum class GraphModel
+	{
+		// One vertex per stop and an edge from every stop of a bus to every later one
+		COMPLETE,
+		// A vertex per stop and per stop of each bus, linked by board, ride and alight edges
+		SPLIT
+	};
+
+	// How make_base keeps the rendered map in the base.
+	enum class MapStorage
+	{
+		// Only the render settings, process_requests renders the map itself
+		NONE,
+		PLAIN,
+		COMPRESSED
+	};
+
+	enum class BaseFormat
+	{
+		PROTOBUF,
+		MAPPED
+	};
+
 	struct RoutingSettings
 	{
 		int bus_wait_time = 0;
 		double bus_velocity = 0;
+		RouterMode router_mode = RouterMode::ALL_PAIRS;
+		GraphModel graph_model = GraphModel::COMPLETE;
+		// Number of routes kept by the route cache, 0 turns the cache off
+		size_t route_cache_size = 0;
 	};
 }
 
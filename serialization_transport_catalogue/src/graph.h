@@ -3,6 +3,7 @@
 #include "ranges.h"
 
 #include <cstdlib>
+#include <utility>
 #include <vector>
 
 namespace graph
@@ -29,11 +30,17 @@ namespace graph
     public:
         DirectedWeightedGraph() = default;
         explicit DirectedWeightedGraph(size_t vertex_count);
+        DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>>&& edges);
         EdgeId AddEdge(const Edge<Weight>& edge);
 
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
         const Edge<Weight>& GetEdge(EdgeId edge_id) const;
+        // GetEdge without the range check, for ids known to be valid.
+        const Edge<Weight>& GetEdgeUnchecked(EdgeId edge_id) const
+        {
+            return edges_[edge_id];
+        }
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
         std::vector<Edge<Weight>> GetEdges() const
         {
@@ -59,6 +66,26 @@ namespace graph
         : incidence_lists_(vertex_count)
     {}
 
+    template <typename Weight>
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>>&& edges)
+        : edges_(std::move(edges))
+        , incidence_lists_(vertex_count)
+    {
+        std::vector<size_t> degrees(vertex_count);
+        for (const auto& edge : edges_)
+        {
+            ++degrees.at(edge.from);
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+        {
+            incidence_lists_[vertex].reserve(degrees[vertex]);
+        }
+        for (EdgeId id = 0; id < edges_.size(); ++id)
+        {
+            incidence_lists_[edges_[id].from].push_back(id);
+        }
+    }
+
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) 
     {
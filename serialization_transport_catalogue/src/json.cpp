@@ -1,5 +1,7 @@
 #include "json.h"
+#include "json_parser.h"
 
+#include <charconv>
 #include <iterator>
 
 namespace json {
@@ -7,7 +9,7 @@ namespace json {
     namespace {
         using namespace std::literals;
 
-        Node LoadNode(std::istream& input);
+        void LoadNode(std::istream& input, Handler& handler);
         Node LoadString(std::istream& input);
 
         std::string LoadLiteral(std::istream& input) 
@@ -20,29 +22,27 @@ namespace json {
             return s;
         }
 
-        Node LoadArray(std::istream& input) 
+        void LoadArray(std::istream& input, Handler& handler) 
         {
-            std::vector<Node> result;
-
+            handler.StartArray();
             for (char c; input >> c && c != ']';)
             {
                 if (c != ',') 
                 {
                     input.putback(c);
                 }
-                result.push_back(LoadNode(input));
+                LoadNode(input, handler);
             }
             if (!input) 
             {
                 throw ParsingError("Array parsing error in "s + __FUNCTION__);
             }
-            return Node(std::move(result));
+            handler.EndArray();
         }
 
-        Node LoadDict(std::istream& input) 
+        void LoadDict(std::istream& input, Handler& handler) 
         {
-            Dict dict;
-
+            handler.StartDict();
             for (char c; input >> c && c != '}';)
             {
                 if (c == '"')
@@ -50,11 +50,8 @@ namespace json {
                     std::string key = LoadString(input).AsString();
                     if (input >> c && c == ':')
                     {
-                        if (dict.find(key) != dict.end())
-                        {
-                            throw ParsingError("Duplicate key '"s + key + "' have been found in " + __FUNCTION__);
-                        }
-                        dict.emplace(std::move(key), LoadNode(input));
+                        handler.Key(std::move(key));
+                        LoadNode(input, handler);
                     }
                     else 
                     {
@@ -70,7 +67,7 @@ namespace json {
             {
                 throw ParsingError("Dictionary parsing error in "s + __FUNCTION__);
             }
-            return Node(std::move(dict));
+            handler.EndDict();
         }
 
         Node LoadString(std::istream& input)
@@ -247,7 +244,7 @@ namespace json {
             }
         }
 
-        Node LoadNode(std::istream& input)
+        void LoadNode(std::istream& input, Handler& handler)
         {
             char c;
             if (!(input >> c)) 
@@ -257,11 +254,14 @@ namespace json {
             switch (c)
             {
             case '[':
-                return LoadArray(input);
+                LoadArray(input, handler);
+                break;
             case '{':
-                return LoadDict(input);
+                LoadDict(input, handler);
+                break;
             case '"':
-                return LoadString(input);
+                handler.Value(LoadString(input));
+                break;
             case 't':
                 //  [[fallthrough]] ()   ,  
                 //    ,     
@@ -272,165 +272,416 @@ namespace json {
                 [[fallthrough]];
             case 'f':
                 input.putback(c);
-                return LoadBool(input);
+                handler.Value(LoadBool(input));
+                break;
             case 'n':
                 input.putback(c);
-                return LoadNull(input);
+                handler.Value(LoadNull(input));
+                break;
             default:
                 input.putback(c);
-                return LoadNumber(input);
+                handler.Value(LoadNumber(input));
+                break;
             }
         }
 
-        struct PrintContext
+        // Passes the events of detail::BufferParser to a Handler.
+        class HandlerSink
         {
-            std::ostream& out;
-            int indent_step = 4;
-            int indent = 0;
+        public:
+            explicit HandlerSink(Handler& handler)
+                : handler_(handler)
+            {
+            }
 
-            void PrintIndent() const 
+            void StartDict()
             {
-                for (int i = 0; i < indent; ++i)
-                {
-                    out.put(' ');
-                }
+                handler_.StartDict();
+            }
+
+            void EndDict()
+            {
+                handler_.EndDict();
+            }
+
+            void StartArray()
+            {
+                handler_.StartArray();
+            }
+
+            void EndArray()
+            {
+                handler_.EndArray();
             }
 
-            PrintContext Indented() const 
+            void Key(std::string_view key, bool /*in_input*/)
             {
-                return { out, indent_step, indent_step + indent };
+                handler_.Key(std::string(key));
             }
+
+            void String(std::string_view value, bool /*in_input*/)
+            {
+                handler_.Value(Node(std::string(value)));
+            }
+
+            void Int(int value)
+            {
+                handler_.Value(Node(value));
+            }
+
+            void Double(double value)
+            {
+                handler_.Value(Node(value));
+            }
+
+            void Bool(bool value)
+            {
+                handler_.Value(Node(value));
+            }
+
+            void Null()
+            {
+                handler_.Value(Node(nullptr));
+            }
+
+        private:
+            Handler& handler_;
         };
 
-        void PrintNode(const Node& value, const PrintContext& ctx);
+    }  // namespace
+
+    //----------------------class NodeBuilder
 
-        template <typename Value>
-        void PrintValue(const Value& value, const PrintContext& ctx)
+    void NodeBuilder::StartDict()
+    {
+        stack_.push_back({ true });
+    }
+
+    void NodeBuilder::EndDict()
+    {
+        if (stack_.empty() || !stack_.back().is_dict)
         {
-            ctx.out << value;
+            throw ParsingError("Unexpected end of dictionary in "s + __FUNCTION__);
         }
+        Dict dict = std::move(stack_.back().dict);
+        stack_.pop_back();
+        AddNode(Node(std::move(dict)));
+    }
 
-        void PrintString(const std::string& value, std::ostream& out)
+    void NodeBuilder::StartArray()
+    {
+        stack_.push_back({ false });
+    }
+
+    void NodeBuilder::EndArray()
+    {
+        if (stack_.empty() || stack_.back().is_dict)
         {
-            out.put('"');
-            for (const char c : value)
-            {
-                switch (c) 
-                {
-                case '\r':
-                    out << "\\r"sv;
-                    break;
-                case '\n':
-                    out << "\\n"sv;
-                    break;
-                case '"':
-                    //  "  \   \"  \\, 
-                    [[fallthrough]];
-                case '\\':
-                    out.put('\\');
-                    [[fallthrough]];
-                default:
-                    out.put(c);
-                    break;
-                }
-            }
-            out.put('"');
+            throw ParsingError("Unexpected end of array in "s + __FUNCTION__);
         }
+        Array array = std::move(stack_.back().array);
+        stack_.pop_back();
+        AddNode(Node(std::move(array)));
+    }
 
-        template <>
-        void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) 
+    void NodeBuilder::Key(std::string&& key)
+    {
+        if (stack_.empty() || !stack_.back().is_dict)
         {
-            PrintString(value, ctx.out);
+            throw ParsingError("Unexpected key '"s + key + "' in "s + __FUNCTION__);
         }
+        if (stack_.back().dict.count(key))
+        {
+            throw ParsingError("Duplicate key '"s + key + "' have been found in " + __FUNCTION__);
+        }
+        stack_.back().key = std::move(key);
+    }
 
-        template <>
-        void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx)
+    void NodeBuilder::Value(Node&& value)
+    {
+        AddNode(std::move(value));
+    }
+
+    Node NodeBuilder::Extract()
+    {
+        if (!ready_)
         {
-            ctx.out << "null"sv;
+            throw ParsingError("Value is not complete in "s + __FUNCTION__);
         }
+        ready_ = false;
+        return std::move(root_);
+    }
 
-        //    PrintValue   bool  value 
-        //   ,     .
-        //      :
-        // void PrintValue(bool value, const PrintContext& ctx);
-        template <>
-        void PrintValue<bool>(const bool& value, const PrintContext& ctx) 
+    void NodeBuilder::AddNode(Node&& node)
+    {
+        if (stack_.empty())
         {
-            ctx.out << (value ? "true"sv : "false"sv);
+            root_ = std::move(node);
+            ready_ = true;
         }
+        else if (stack_.back().is_dict)
+        {
+            Frame& frame = stack_.back();
+            frame.dict.emplace(std::move(frame.key), std::move(node));
+            frame.key.clear();
+        }
+        else
+        {
+            stack_.back().array.push_back(std::move(node));
+        }
+    }
+
+    Document Load(std::istream& input)
+    {
+        NodeBuilder builder;
+        LoadNode(input, builder);
+        return Document{ builder.Extract() };
+    }
+
+    void LoadEvents(std::istream& input, Handler& handler)
+    {
+        LoadNode(input, handler);
+    }
+
+    Document Load(std::string_view input)
+    {
+        NodeBuilder builder;
+        LoadEvents(input, builder);
+        return Document{ builder.Extract() };
+    }
+
+    void LoadEvents(std::string_view input, Handler& handler)
+    {
+        HandlerSink sink(handler);
+        detail::BufferParser<HandlerSink>(input, sink).ParseNode();
+    }
+
+    void LoadEventsInChunks(std::istream& input, Handler& handler)
+    {
+        HandlerSink sink(handler);
+        detail::BufferParser<HandlerSink, detail::StreamInput>(detail::StreamInput(input), sink).ParseNode();
+    }
+
+    std::string ReadInput(std::istream& input)
+    {
+        // Read straight into the result: ostringstream::str() copies its buffer before C++20
+        std::string result;
+        while (input)
+        {
+            const size_t size = result.size();
+            result.resize(size + detail::READ_CHUNK_SIZE);
+            input.read(result.data() + size, static_cast<std::streamsize>(detail::READ_CHUNK_SIZE));
+            result.resize(size + static_cast<size_t>(input.gcount()));
+        }
+        return result;
+    }
 
-        template <>
-        void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) 
+    //----------------------class Writer
+
+    Writer::Writer(std::ostream& output, PrintStyle style)
+        : output_(output)
+        , style_(style)
+    {
+        buffer_.reserve(FLUSH_SIZE);
+    }
+
+    Writer::~Writer()
+    {
+        Flush();
+    }
+
+    Writer& Writer::StartDict()
+    {
+        StartItem();
+        buffer_ += style_ == PrintStyle::PRETTY ? "{\n"sv : "{"sv;
+        empty_.push_back(true);
+        return *this;
+    }
+
+    Writer& Writer::EndDict()
+    {
+        EndContainer('}');
+        return *this;
+    }
+
+    Writer& Writer::StartArray()
+    {
+        StartItem();
+        buffer_ += style_ == PrintStyle::PRETTY ? "[\n"sv : "["sv;
+        empty_.push_back(true);
+        return *this;
+    }
+
+    Writer& Writer::EndArray()
+    {
+        EndContainer(']');
+        return *this;
+    }
+
+    Writer& Writer::Key(std::string_view key)
+    {
+        StartItem();
+        AppendString(key);
+        buffer_ += style_ == PrintStyle::PRETTY ? ": "sv : ":"sv;
+        after_key_ = true;
+        return *this;
+    }
+
+    Writer& Writer::Value(std::nullptr_t)
+    {
+        StartItem();
+        buffer_ += "null"sv;
+        return *this;
+    }
+
+    Writer& Writer::Value(bool value)
+    {
+        StartItem();
+        buffer_ += value ? "true"sv : "false"sv;
+        return *this;
+    }
+
+    Writer& Writer::Value(int value)
+    {
+        StartItem();
+        char chars[16];
+        const auto result = std::to_chars(std::begin(chars), std::end(chars), value);
+        buffer_.append(chars, result.ptr);
+        return *this;
+    }
+
+    Writer& Writer::Value(double value)
+    {
+        StartItem();
+        char chars[32];
+        const auto result = std::to_chars(std::begin(chars), std::end(chars), value, std::chars_format::general, 6);
+        buffer_.append(chars, result.ptr);
+        return *this;
+    }
+
+    Writer& Writer::Value(std::string_view value)
+    {
+        StartItem();
+        AppendString(value);
+        return *this;
+    }
+
+    Writer& Writer::Value(const Node& node)
+    {
+        if (node.IsArray())
         {
-            std::ostream& out = ctx.out;
-            out << "[\n"sv;
-            bool first = true;
-            auto inner_ctx = ctx.Indented();
-            for (const Node& node : nodes) 
+            StartArray();
+            for (const Node& item : node.AsArray())
             {
-                if (first)
-                {
-                    first = false;
-                }
-                else
-                {
-                    out << ",\n"sv;
-                }
-                inner_ctx.PrintIndent();
-                PrintNode(node, inner_ctx);
+                Value(item);
             }
-            out.put('\n');
-            ctx.PrintIndent();
-            out.put(']');
+            return EndArray();
         }
-
-        template <>
-        void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx)
+        if (node.IsDict())
         {
-            std::ostream& out = ctx.out;
-            out << "{\n"sv;
-            bool first = true;
-            auto inner_ctx = ctx.Indented();
-            for (const auto& [key, node] : nodes)
+            StartDict();
+            for (const auto& [key, item] : node.AsDict())
             {
-                if (first)
-                {
-                    first = false;
-                }
-                else 
-                {
-                    out << ",\n"sv;
-                }
-                inner_ctx.PrintIndent();
-                PrintString(key, ctx.out);
-                out << ": "sv;
-                PrintNode(node, inner_ctx);
-            }
-            out.put('\n');
-            ctx.PrintIndent();
-            out.put('}');
+                Key(key).Value(item);
+            }
+            return EndDict();
+        }
+        if (node.IsString())
+        {
+            return Value(std::string_view(node.AsString()));
+        }
+        if (node.IsInt())
+        {
+            return Value(node.AsInt());
+        }
+        if (node.IsPureDouble())
+        {
+            return Value(node.AsDouble());
+        }
+        if (node.IsBool())
+        {
+            return Value(node.AsBool());
         }
+        return Value(nullptr);
+    }
 
-        void PrintNode(const Node& node, const PrintContext& ctx) 
+    void Writer::Flush()
+    {
+        output_.write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+    void Writer::StartItem()
+    {
+        if (after_key_)
         {
-            std::visit(
-                [&ctx](const auto& value) 
-                {
-                    PrintValue(value, ctx);
-                },
-                node.GetValue());
+            after_key_ = false;
+            return;
+        }
+        if (buffer_.size() >= FLUSH_SIZE)
+        {
+            Flush();
         }
+        if (empty_.empty())
+        {
+            return;
+        }
+        if (!empty_.back())
+        {
+            buffer_ += style_ == PrintStyle::PRETTY ? ",\n"sv : ","sv;
+        }
+        empty_.back() = false;
+        if (style_ == PrintStyle::PRETTY)
+        {
+            buffer_.append(empty_.size() * INDENT_STEP, ' ');
+        }
+    }
 
-    }  // namespace
+    void Writer::EndContainer(char bracket)
+    {
+        empty_.pop_back();
+        if (style_ == PrintStyle::PRETTY)
+        {
+            buffer_ += '\n';
+            buffer_.append(empty_.size() * INDENT_STEP, ' ');
+        }
+        buffer_ += bracket;
+    }
 
-    Document Load(std::istream& input)
+    void Writer::AppendString(std::string_view value)
     {
-        return Document{ LoadNode(input) };
+        buffer_ += '"';
+        size_t begin = 0;
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            const char c = value[i];
+            if (c != '\r' && c != '\n' && c != '"' && c != '\\')
+            {
+                continue;
+            }
+            buffer_.append(value.substr(begin, i - begin));
+            switch (c)
+            {
+            case '\r':
+                buffer_ += "\\r"sv;
+                break;
+            case '\n':
+                buffer_ += "\\n"sv;
+                break;
+            default:
+                buffer_ += '\\';
+                buffer_ += c;
+                break;
+            }
+            begin = i + 1;
+        }
+        buffer_.append(value.substr(begin));
+        buffer_ += '"';
     }
 
-    void Print(const Document& doc, std::ostream& output)
+    void Print(const Document& doc, std::ostream& output, PrintStyle style)
     {
-        PrintNode(doc.GetRoot(), PrintContext{ output });       
+        Writer(output, style).Value(doc.GetRoot());
     }
 
 }  // namespace json
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -164,8 +165,134 @@ namespace json
         return !(lhs == rhs);
     }
 
+    // Receiver of parsing events: containers are reported by their bounds, scalars
+    // (null, bool, numbers and strings) by Value.
+    class Handler
+    {
+    public:
+        virtual void StartDict() = 0;
+        virtual void EndDict() = 0;
+        virtual void StartArray() = 0;
+        virtual void EndArray() = 0;
+        virtual void Key(std::string&& key) = 0;
+        virtual void Value(Node&& value) = 0;
+
+    protected:
+        ~Handler() = default;
+    };
+
+    // Handler collecting the events of one value into a Node.
+    class NodeBuilder final : public Handler
+    {
+    public:
+        void StartDict() override;
+        void EndDict() override;
+        void StartArray() override;
+        void EndArray() override;
+        void Key(std::string&& key) override;
+        void Value(Node&& value) override;
+
+        // True when a complete value has been collected.
+        bool IsReady() const noexcept
+        {
+            return ready_;
+        }
+
+        Node Extract();
+
+    private:
+        struct Frame
+        {
+            bool is_dict = false;
+            Array array{};
+            Dict dict{};
+            std::string key{};
+        };
+
+        void AddNode(Node&& node);
+
+        std::vector<Frame> stack_;
+        Node root_;
+        bool ready_ = false;
+    };
+
     Document Load(std::istream& input);
 
-    void Print(const Document& doc, std::ostream& output);
+    // Parses one value from input reporting it to handler without building nodes.
+    void LoadEvents(std::istream& input, Handler& handler);
+
+    // Same as above for input already held in memory, e.g. read with ReadInput.
+    // Much faster than the stream versions which go through the stream per character.
+    Document Load(std::string_view input);
+
+    void LoadEvents(std::string_view input, Handler& handler);
+
+    // Same as LoadEvents above for a stream read chunk by chunk: the buffer parser holds only
+    // a chunk of the input and the token being parsed. May read the stream past the value.
+    void LoadEventsInChunks(std::istream& input, Handler& handler);
+
+    std::string ReadInput(std::istream& input);
+
+    // PRETTY indents nested values by 4 spaces, COMPACT prints no whitespace at all.
+    enum class PrintStyle
+    {
+        PRETTY,
+        COMPACT
+    };
+
+    // Formats JSON into a reusable buffer which is passed to the stream in large blocks.
+    // Numbers are formatted with std::to_chars, doubles with 6 significant digits as
+    // the default std::ostream does, so PRETTY output is the same as before.
+    class Writer
+    {
+    public:
+        explicit Writer(std::ostream& output, PrintStyle style = PrintStyle::PRETTY);
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        ~Writer();
+
+        Writer& StartDict();
+        Writer& EndDict();
+        Writer& StartArray();
+        Writer& EndArray();
+        Writer& Key(std::string_view key);
+
+        Writer& Value(std::nullptr_t);
+        Writer& Value(bool value);
+        Writer& Value(int value);
+        Writer& Value(double value);
+        Writer& Value(std::string_view value);
+        Writer& Value(const char* value)
+        {
+            return Value(std::string_view(value));
+        }
+        Writer& Value(const std::string& value)
+        {
+            return Value(std::string_view(value));
+        }
+        Writer& Value(const Node& node);
+
+        // Passes the buffered text to the stream.
+        void Flush();
+
+    private:
+        static constexpr size_t FLUSH_SIZE = 64 * 1024;
+        static constexpr int INDENT_STEP = 4;
+
+        void StartItem();
+        void EndContainer(char bracket);
+        void AppendString(std::string_view value);
+
+        std::ostream& output_;
+        PrintStyle style_;
+        std::string buffer_;
+        // For every open container: whether it has no items yet
+        std::vector<bool> empty_;
+        bool after_key_ = false;
+    };
+
+    void Print(const Document& doc, std::ostream& output, PrintStyle style = PrintStyle::PRETTY);
 
 }  // namespace json
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "json_arena.h"
+#include "json_parser.h"
+
+namespace json
+{
+
+    namespace
+    {
+        using namespace std::literals;
+
+        // Builds the nodes of detail::BufferParser events. Items of the open containers
+        // are collected on two scratch stacks and copied into the arena when the
+        // container ends.
+        class ArenaSink
+        {
+        public:
+            explicit ArenaSink(Arena& arena)
+                : arena_(arena)
+            {
+            }
+
+            void StartDict()
+            {
+                frames_.push_back({ true, members_.size(), {} });
+            }
+
+            void EndDict()
+            {
+                const size_t first = frames_.back().first;
+                frames_.pop_back();
+                std::sort(members_.begin() + first, members_.end(),
+                    [](const ArenaMember& lhs, const ArenaMember& rhs)
+                    {
+                        return lhs.first < rhs.first;
+                    });
+                const auto duplicate = std::adjacent_find(members_.begin() + first, members_.end(),
+                    [](const ArenaMember& lhs, const ArenaMember& rhs)
+                    {
+                        return lhs.first == rhs.first;
+                    });
+                if (duplicate != members_.end())
+                {
+                    throw ParsingError("Duplicate key '"s + std::string(duplicate->first) + "' have been found in " + __FUNCTION__);
+                }
+                const size_t size = members_.size() - first;
+                const ArenaMember* members = arena_.Copy(members_.data() + first, members_.data() + members_.size());
+                members_.resize(first);
+                AddNode(ArenaDict(members, size));
+            }
+
+            void StartArray()
+            {
+                frames_.push_back({ false, items_.size(), {} });
+            }
+
+            void EndArray()
+            {
+                const size_t first = frames_.back().first;
+                frames_.pop_back();
+                const size_t size = items_.size() - first;
+                const ArenaNode* items = arena_.Copy(items_.data() + first, items_.data() + items_.size());
+                items_.resize(first);
+                AddNode(ArenaArray(items, size));
+            }
+
+            void Key(std::string_view key, bool in_input)
+            {
+                frames_.back().key = in_input ? key : arena_.Copy(key);
+            }
+
+            void String(std::string_view value, bool in_input)
+            {
+                AddNode(in_input ? value : arena_.Copy(value));
+            }
+
+            void Int(int value)
+            {
+                AddNode(value);
+            }
+
+            void Double(double value)
+            {
+                AddNode(value);
+            }
+
+            void Bool(bool value)
+            {
+                AddNode(value);
+            }
+
+            void Null()
+            {
+                AddNode(nullptr);
+            }
+
+            ArenaNode GetRoot() const
+            {
+                return root_;
+            }
+
+        private:
+            struct Frame
+            {
+                bool is_dict;
+                size_t first;
+                std::string_view key;
+            };
+
+            void AddNode(ArenaNode node)
+            {
+                if (frames_.empty())
+                {
+                    root_ = node;
+                }
+                else if (frames_.back().is_dict)
+                {
+                    members_.push_back({ frames_.back().key, node });
+                }
+                else
+                {
+                    items_.push_back(node);
+                }
+            }
+
+            Arena& arena_;
+            std::vector<Frame> frames_;
+            std::vector<ArenaMember> members_;
+            std::vector<ArenaNode> items_;
+            ArenaNode root_;
+        };
+    }
+
+    //----------------------class Arena
+
+    Arena::Arena(size_t block_size)
+        : block_size_(block_size)
+    {
+    }
+
+    void* Arena::Allocate(size_t size, size_t alignment)
+    {
+        const size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(pos_) % alignment) % alignment;
+        if (pos_ == nullptr || static_cast<size_t>(end_ - pos_) < padding + size)
+        {
+            const size_t block_size = std::max(block_size_, size + alignment);
+            blocks_.push_back(std::make_unique<char[]>(block_size));
+            pos_ = blocks_.back().get();
+            end_ = pos_ + block_size;
+            return Allocate(size, alignment);
+        }
+        void* result = pos_ + padding;
+        pos_ += padding + size;
+        return result;
+    }
+
+    std::string_view Arena::Copy(std::string_view str)
+    {
+        return { Copy(str.data(), str.data() + str.size()), str.size() };
+    }
+
+    //----------------------class ArenaNode
+
+    Node ArenaNode::ToNode() const
+    {
+        switch (type_)
+        {
+        case Type::ARRAY:
+        {
+            Array array;
+            array.reserve(size_);
+            for (const ArenaNode& item : AsArray())
+            {
+                array.push_back(item.ToNode());
+            }
+            return array;
+        }
+        case Type::DICT:
+        {
+            Dict dict;
+            for (const auto& [key, value] : AsDict())
+            {
+                dict.emplace_hint(dict.end(), std::string(key), value.ToNode());
+            }
+            return dict;
+        }
+        case Type::BOOL:
+            return bool_;
+        case Type::INT:
+            return int_;
+        case Type::DOUBLE:
+            return double_;
+        case Type::STRING:
+            return std::string(AsString());
+        default:
+            return nullptr;
+        }
+    }
+
+    //----------------------class ArenaDocument
+
+    ArenaDocument::ArenaDocument(std::string input)
+        : input_(std::move(input))
+    {
+        ArenaSink sink(arena_);
+        detail::BufferParser<ArenaSink>(input_, sink).ParseNode();
+        root_ = sink.GetRoot();
+    }
+
+}  // namespace json
@@ -0,0 +1,375 @@
+#pragma once
+#include "json.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Read-only JSON DOM for large inputs. All nodes of a document live in one arena,
+// dictionaries are arrays of members sorted by key and strings are views into the
+// input whenever they have no escapes, so loading does a handful of allocations.
+namespace json
+{
+
+    // Bump allocator: memory is handed out from big blocks and freed all at once.
+    class Arena
+    {
+    public:
+        explicit Arena(size_t block_size = 64 * 1024);
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        void* Allocate(size_t size, size_t alignment);
+
+        // Copies [begin, end) into the arena. T must be trivially destructible.
+        template <typename T>
+        const T* Copy(const T* begin, const T* end);
+
+        std::string_view Copy(std::string_view str);
+
+    private:
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        char* pos_ = nullptr;
+        char* end_ = nullptr;
+        size_t block_size_;
+    };
+
+    template <typename T>
+    const T* Arena::Copy(const T* begin, const T* end)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "Arena never calls destructors");
+        if (begin == end)
+        {
+            return nullptr;
+        }
+        T* result = static_cast<T*>(Allocate(sizeof(T) * (end - begin), alignof(T)));
+        std::uninitialized_copy(begin, end, result);
+        return result;
+    }
+
+    class ArenaNode;
+    struct ArenaMember;
+
+    class ArenaArray
+    {
+    public:
+        ArenaArray(const ArenaNode* begin, size_t size)
+            : begin_(begin)
+            , size_(size)
+        {
+        }
+
+        const ArenaNode* begin() const
+        {
+            return begin_;
+        }
+
+        const ArenaNode* end() const;
+
+        size_t size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        const ArenaNode& operator[](size_t index) const;
+
+    private:
+        const ArenaNode* begin_;
+        size_t size_;
+    };
+
+    // Members sorted by key. Lookup functions are named like the ones of Dict so that
+    // code reading requests can be written once for both DOMs.
+    class ArenaDict
+    {
+    public:
+        ArenaDict(const ArenaMember* begin, size_t size)
+            : begin_(begin)
+            , size_(size)
+        {
+        }
+
+        const ArenaMember* begin() const
+        {
+            return begin_;
+        }
+
+        const ArenaMember* end() const;
+
+        size_t size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        // Returns end() if there is no such key.
+        const ArenaMember* find(std::string_view key) const;
+
+        size_t count(std::string_view key) const;
+
+        // Throws std::out_of_range if there is no such key.
+        const ArenaNode& at(std::string_view key) const;
+
+    private:
+        const ArenaMember* begin_;
+        size_t size_;
+    };
+
+    class ArenaNode final
+    {
+    public:
+        enum class Type : std::uint8_t
+        {
+            NUL,
+            ARRAY,
+            DICT,
+            BOOL,
+            INT,
+            DOUBLE,
+            STRING
+        };
+
+        ArenaNode() = default;
+
+        ArenaNode(std::nullptr_t)
+        {
+        }
+
+        ArenaNode(bool value)
+            : type_(Type::BOOL)
+            , bool_(value)
+        {
+        }
+
+        ArenaNode(int value)
+            : type_(Type::INT)
+            , int_(value)
+        {
+        }
+
+        ArenaNode(double value)
+            : type_(Type::DOUBLE)
+            , double_(value)
+        {
+        }
+
+        // The characters are not copied.
+        ArenaNode(std::string_view value)
+            : type_(Type::STRING)
+            , size_(static_cast<std::uint32_t>(value.size()))
+            , chars_(value.data())
+        {
+        }
+
+        ArenaNode(ArenaArray value)
+            : type_(Type::ARRAY)
+            , size_(static_cast<std::uint32_t>(value.size()))
+            , items_(value.begin())
+        {
+        }
+
+        ArenaNode(ArenaDict value)
+            : type_(Type::DICT)
+            , size_(static_cast<std::uint32_t>(value.size()))
+            , members_(value.begin())
+        {
+        }
+
+        Type GetType() const
+        {
+            return type_;
+        }
+
+        bool IsNull() const
+        {
+            return type_ == Type::NUL;
+        }
+
+        bool IsInt() const
+        {
+            return type_ == Type::INT;
+        }
+        int AsInt() const
+        {
+            using namespace std::literals;
+            if (!IsInt())
+            {
+                throw std::logic_error("Not an int"s);
+            }
+            return int_;
+        }
+
+        bool IsPureDouble() const
+        {
+            return type_ == Type::DOUBLE;
+        }
+        bool IsDouble() const
+        {
+            return IsInt() || IsPureDouble();
+        }
+        double AsDouble() const
+        {
+            using namespace std::literals;
+            if (!IsDouble())
+            {
+                throw std::logic_error("Not a double"s);
+            }
+            return IsPureDouble() ? double_ : int_;
+        }
+
+        bool IsBool() const
+        {
+            return type_ == Type::BOOL;
+        }
+        bool AsBool() const
+        {
+            using namespace std::literals;
+            if (!IsBool())
+            {
+                throw std::logic_error("Not a bool"s);
+            }
+            return bool_;
+        }
+
+        bool IsString() const
+        {
+            return type_ == Type::STRING;
+        }
+        std::string_view AsString() const
+        {
+            using namespace std::literals;
+            if (!IsString())
+            {
+                throw std::logic_error("Not a string"s);
+            }
+            return { chars_, size_ };
+        }
+
+        bool IsArray() const
+        {
+            return type_ == Type::ARRAY;
+        }
+        ArenaArray AsArray() const
+        {
+            using namespace std::literals;
+            if (!IsArray())
+            {
+                throw std::logic_error("Not an array"s);
+            }
+            return { items_, size_ };
+        }
+
+        bool IsDict() const
+        {
+            return type_ == Type::DICT;
+        }
+        ArenaDict AsDict() const
+        {
+            using namespace std::literals;
+            if (!IsDict())
+            {
+                throw std::logic_error("Not a dict"s);
+            }
+            return { members_, size_ };
+        }
+
+        // Deep copy into the ordinary DOM.
+        Node ToNode() const;
+
+    private:
+        Type type_ = Type::NUL;
+        std::uint32_t size_ = 0;
+        union
+        {
+            bool bool_;
+            int int_;
+            double double_ = 0.0;
+            const char* chars_;
+            const ArenaNode* items_;
+            const ArenaMember* members_;
+        };
+    };
+
+    struct ArenaMember
+    {
+        std::string_view first;
+        ArenaNode second;
+    };
+
+    inline const ArenaNode* ArenaArray::end() const
+    {
+        return begin_ + size_;
+    }
+
+    inline const ArenaNode& ArenaArray::operator[](size_t index) const
+    {
+        return begin_[index];
+    }
+
+    inline const ArenaMember* ArenaDict::end() const
+    {
+        return begin_ + size_;
+    }
+
+    inline const ArenaMember* ArenaDict::find(std::string_view key) const
+    {
+        const ArenaMember* it = std::lower_bound(begin(), end(), key,
+            [](const ArenaMember& member, std::string_view key)
+            {
+                return member.first < key;
+            });
+        return it != end() && it->first == key ? it : end();
+    }
+
+    inline size_t ArenaDict::count(std::string_view key) const
+    {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    inline const ArenaNode& ArenaDict::at(std::string_view key) const
+    {
+        using namespace std::literals;
+        if (const ArenaMember* it = find(key); it != end())
+        {
+            return it->second;
+        }
+        throw std::out_of_range("Key '"s + std::string(key) + "' is not found"s);
+    }
+
+    // Owns the input text and the arena the nodes live in.
+    class ArenaDocument
+    {
+    public:
+        explicit ArenaDocument(std::string input);
+
+        ArenaDocument(const ArenaDocument&) = delete;
+        ArenaDocument& operator=(const ArenaDocument&) = delete;
+
+        const ArenaNode& GetRoot() const
+        {
+            return root_;
+        }
+
+    private:
+        std::string input_;
+        Arena arena_;
+        ArenaNode root_;
+    };
+
+}  // namespace json
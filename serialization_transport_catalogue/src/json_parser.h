@@ -0,0 +1,552 @@
+#pragma once
+#include "json.h"
+
+#include <cctype>
+#include <charconv>
+#include <istream>
+#include <string>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// JSON parser over a contiguous buffer shared by json::Load and the arena DOM.
+//
+// BufferParser reports what it reads to a Sink with the methods
+//     StartDict(), EndDict(), StartArray(), EndArray(),
+//     Key(std::string_view key, bool in_input), String(std::string_view value, bool in_input),
+//     Int(int value), Double(double value), Bool(bool value), Null().
+// Keys and strings without escapes are views into the input (in_input is true),
+// the others live in a parser buffer until the next string is read.
+//
+// The input comes from a Source: WholeInput for a buffer holding all of it, StreamInput
+// for a stream read chunk by chunk. Views given to the sink are valid until it returns.
+namespace json::detail
+{
+    using namespace std::literals;
+
+    // Finds the first character which ends a plain run of a string: the closing
+    // quote, an escape or a line break. Returns end if there is none.
+    inline const char* FindStringStop(const char* pos, const char* end)
+    {
+#if defined(__AVX2__)
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i line_feed = _mm256_set1_epi8('\n');
+        const __m256i carriage_return = _mm256_set1_epi8('\r');
+        for (; end - pos >= 32; pos += 32)
+        {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+            const __m256i stops = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, line_feed), _mm256_cmpeq_epi8(chunk, carriage_return)));
+            if (const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(stops)); mask != 0)
+            {
+                return pos + __builtin_ctz(mask);
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i line_feed = _mm_set1_epi8('\n');
+        const __m128i carriage_return = _mm_set1_epi8('\r');
+        for (; end - pos >= 16; pos += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            const __m128i stops = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return)));
+            if (const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(stops)); mask != 0)
+            {
+                return pos + __builtin_ctz(mask);
+            }
+        }
+#endif
+        for (; pos != end; ++pos)
+        {
+            if (*pos == '"' || *pos == '\\' || *pos == '\n' || *pos == '\r')
+            {
+                break;
+            }
+        }
+        return pos;
+    }
+
+    inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    inline bool IsDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // Bytes read from a stream at a time
+    inline constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+
+    // Input held in memory as a whole.
+    class WholeInput
+    {
+    public:
+        explicit WholeInput(std::string_view input) noexcept
+            : input_(input)
+        {
+        }
+
+        std::string_view GetWindow() const noexcept
+        {
+            return input_;
+        }
+
+        // There is nothing more to read.
+        bool Refill(const char*& /*keep*/, const char*& /*pos*/, const char*& /*end*/) const noexcept
+        {
+            return false;
+        }
+
+    private:
+        std::string_view input_;
+    };
+
+    // Input read from a stream into a window of a chunk and the token being parsed.
+    class StreamInput
+    {
+    public:
+        explicit StreamInput(std::istream& input, size_t chunk_size = READ_CHUNK_SIZE)
+            : input_(input)
+            , chunk_size_(chunk_size)
+        {
+            Read();
+        }
+
+        StreamInput(StreamInput&&) = default;
+
+        std::string_view GetWindow() const noexcept
+        {
+            return window_;
+        }
+
+        // Drops the window before keep and reads the next chunk after the rest of it.
+        // keep <= pos <= end point into the window and are moved with their bytes.
+        // Returns false at the end of the input.
+        bool Refill(const char*& keep, const char*& pos, const char*& end)
+        {
+            const size_t keep_offset = keep - window_.data();
+            const size_t pos_offset = pos - keep;
+            window_.erase(0, keep_offset);
+            const bool more = Read();
+            keep = window_.data();
+            pos = keep + pos_offset;
+            end = keep + window_.size();
+            return more;
+        }
+
+    private:
+        bool Read()
+        {
+            const size_t size = window_.size();
+            window_.resize(size + chunk_size_);
+            input_.read(window_.data() + size, static_cast<std::streamsize>(chunk_size_));
+            window_.resize(size + static_cast<size_t>(input_.gcount()));
+            return window_.size() != size;
+        }
+
+        std::istream& input_;
+        size_t chunk_size_;
+        std::string window_;
+    };
+
+    // Same grammar and errors as the stream loaders of json.cpp.
+    template <typename Sink, typename Source = WholeInput>
+    class BufferParser
+    {
+    public:
+        BufferParser(std::string_view input, Sink& sink)
+            : BufferParser(Source(input), sink)
+        {
+        }
+
+        BufferParser(Source source, Sink& sink)
+            : source_(std::move(source))
+            , sink_(sink)
+        {
+            const std::string_view window = source_.GetWindow();
+            pos_ = window.data();
+            end_ = window.data() + window.size();
+        }
+
+        void ParseNode();
+
+    private:
+        // Refills the input when all of it has been read, keeping the token being parsed.
+        // Returns false at the end of the input.
+        bool More();
+
+        // Returns false at the end of the input.
+        bool HasChar()
+        {
+            return pos_ != end_ || More();
+        }
+
+        bool NextChar(char& c);
+
+        void ParseArray();
+
+        void ParseDict();
+
+        // Returns true if the string has been taken from the input as is.
+        bool ParseString(std::string_view& result);
+
+        std::string_view ParseLiteral();
+
+        void ParseBool();
+
+        void ParseNull();
+
+        void ParseDigits();
+
+        void ParseNumber();
+
+        Source source_;
+        const char* pos_ = nullptr;
+        const char* end_ = nullptr;
+        // Start of the token being parsed, which a refill keeps; none between tokens
+        const char* token_ = nullptr;
+        Sink& sink_;
+        std::string unescaped_;
+    };
+
+    template <typename Sink, typename Source>
+    void BufferParser<Sink, Source>::ParseNode()
+    {
+        char c;
+        if (!NextChar(c))
+        {
+            throw ParsingError("Unexpected EOF in "s + __FUNCTION__);
+        }
+        switch (c)
+        {
+        case '[':
+            ParseArray();
+            break;
+        case '{':
+            ParseDict();
+            break;
+        case '"':
+        {
+            std::string_view value;
+            const bool in_input = ParseString(value);
+            sink_.String(value, in_input);
+            break;
+        }
+        case 't':
+            [[fallthrough]];
+        case 'f':
+            --pos_;
+            ParseBool();
+            break;
+        case 'n':
+            --pos_;
+            ParseNull();
+            break;
+        default:
+            --pos_;
+            ParseNumber();
+            break;
+        }
+    }
+
+    template <typename Sink, typename Source>
+    bool BufferParser<Sink, Source>::More()
+    {
+        const char* keep = token_ ? token_ : pos_;
+        const bool more = source_.Refill(keep, pos_, end_);
+        if (token_)
+        {
+            token_ = keep;
+        }
+        return more;
+    }
+
+    template <typename Sink, typename Source>
+    bool BufferParser<Sink, Source>::NextChar(char& c)
+    {
+        do
+        {
+            while (pos_ != end_ && IsSpace(*pos_))
+            {
+                ++pos_;
+            }
+        } while (pos_ == end_ && More());
+        if (pos_ == end_)
+        {
+            return false;
+        }
+        c = *pos_++;
+        return true;
+    }
+
+    template <typename Sink, typename Source>
+    void BufferParser<Sink, Source>::ParseArray()
+    {
+        sink_.StartArray();
+        char c;
+        while (true)
+        {
+            if (!NextChar(c))
+            {
+                throw ParsingError("Array parsing error in "s + __FUNCTION__);
+            }
+            if (c == ']')
+            {
+                break;
+            }
+            if (c != ',')
+            {
+                --pos_;
+            }
+            ParseNode();
+        }
+        sink_.EndArray();
+    }
+
+    template <typename Sink, typename Source>
+    void BufferParser<Sink, Source>::ParseDict()
+    {
+        sink_.StartDict();
+        char c;
+        while (true)
+        {
+            if (!NextChar(c))
+            {
+                throw ParsingError("Dictionary parsing error in "s + __FUNCTION__);
+            }
+            if (c == '}')
+            {
+                break;
+            }
+            if (c == '"')
+            {
+                std::string_view key;
+                const bool in_input = ParseString(key);
+                // A key in the input is kept until the colon has been read
+                token_ = in_input ? key.data() : nullptr;
+                if (!NextChar(c))
+                {
+                    throw ParsingError("Dictionary parsing error in "s + __FUNCTION__);
+                }
+                if (c != ':')
+                {
+                    throw ParsingError(": is expected but '"s + c + "' has been found in "s + __FUNCTION__);
+                }
+                if (in_input)
+                {
+                    key = { token_, key.size() };
+                    token_ = nullptr;
+                }
+                sink_.Key(key, in_input);
+                ParseNode();
+            }
+            else if (c != ',')
+            {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found in "s + __FUNCTION__);
+            }
+        }
+        sink_.EndDict();
+    }
+
+    template <typename Sink, typename Source>
+    bool BufferParser<Sink, Source>::ParseString(std::string_view& result)
+    {
+        token_ = pos_;
+        const char* stop = FindStringStop(pos_, end_);
+        while (stop == end_)
+        {
+            const size_t scanned = stop - token_;
+            const bool more = More();
+            stop = token_ + scanned;
+            if (!more)
+            {
+                break;
+            }
+            stop = FindStringStop(stop, end_);
+        }
+        if (stop != end_ && *stop == '"')
+        {
+            pos_ = stop + 1;
+            result = { token_, static_cast<size_t>(stop - token_) };
+            token_ = nullptr;
+            return true;
+        }
+
+        token_ = nullptr;
+        unescaped_.clear();
+        while (true)
+        {
+            unescaped_.append(pos_, stop);
+            pos_ = stop;
+            if (pos_ == end_)
+            {
+                if (!More())
+                {
+                    throw ParsingError("String parsing error in "s + __FUNCTION__);
+                }
+                stop = FindStringStop(pos_, end_);
+                continue;
+            }
+            const char ch = *pos_++;
+            if (ch == '"')
+            {
+                result = unescaped_;
+                return false;
+            }
+            if (ch != '\\')
+            {
+                throw ParsingError("Unexpected end of line in "s + __FUNCTION__);
+            }
+            if (!HasChar())
+            {
+                throw ParsingError("String parsing error in "s + __FUNCTION__);
+            }
+            const char escaped_char = *pos_++;
+            switch (escaped_char)
+            {
+            case 'n':
+                unescaped_.push_back('\n');
+                break;
+            case 't':
+                unescaped_.push_back('\t');
+                break;
+            case 'r':
+                unescaped_.push_back('\r');
+                break;
+            case '"':
+                unescaped_.push_back('"');
+                break;
+            case '\\':
+                unescaped_.push_back('\\');
+                break;
+            default:
+                throw ParsingError("Unrecognized escape sequence \\"s + escaped_char + " in "s + __FUNCTION__);
+            }
+            stop = FindStringStop(pos_, end_);
+        }
+    }
+
+    template <typename Sink, typename Source>
+    std::string_view BufferParser<Sink, Source>::ParseLiteral()
+    {
+        token_ = pos_;
+        while (HasChar() && std::isalpha(static_cast<unsigned char>(*pos_)))
+        {
+            ++pos_;
+        }
+        const std::string_view literal(token_, static_cast<size_t>(pos_ - token_));
+        token_ = nullptr;
+        return literal;
+    }
+
+    template <typename Sink, typename Source>
+    void BufferParser<Sink, Source>::ParseBool()
+    {
+        const std::string_view s = ParseLiteral();
+        if (s == "true"sv)
+        {
+            sink_.Bool(true);
+        }
+        else if (s == "false"sv)
+        {
+            sink_.Bool(false);
+        }
+        else
+        {
+            throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool in "s + __FUNCTION__);
+        }
+    }
+
+    template <typename Sink, typename Source>
+    void BufferParser<Sink, Source>::ParseNull()
+    {
+        if (const std::string_view literal = ParseLiteral(); literal == "null"sv)
+        {
+            sink_.Null();
+        }
+        else
+        {
+            throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null in "s + __FUNCTION__);
+        }
+    }
+
+    template <typename Sink, typename Source>
+    void BufferParser<Sink, Source>::ParseDigits()
+    {
+        if (!HasChar() || !IsDigit(*pos_))
+        {
+            throw ParsingError("A digit is expected in "s + __FUNCTION__);
+        }
+        while (HasChar() && IsDigit(*pos_))
+        {
+            ++pos_;
+        }
+    }
+
+    template <typename Sink, typename Source>
+    void BufferParser<Sink, Source>::ParseNumber()
+    {
+        token_ = pos_;
+        if (HasChar() && *pos_ == '-')
+        {
+            ++pos_;
+        }
+        if (HasChar() && *pos_ == '0')
+        {
+            ++pos_;
+        }
+        else
+        {
+            ParseDigits();
+        }
+
+        bool is_int = true;
+        if (HasChar() && *pos_ == '.')
+        {
+            ++pos_;
+            ParseDigits();
+            is_int = false;
+        }
+        if (HasChar() && (*pos_ == 'e' || *pos_ == 'E'))
+        {
+            ++pos_;
+            if (HasChar() && (*pos_ == '+' || *pos_ == '-'))
+            {
+                ++pos_;
+            }
+            ParseDigits();
+            is_int = false;
+        }
+
+        const char* begin = token_;
+        token_ = nullptr;
+        if (is_int)
+        {
+            int value = 0;
+            if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc{} && ptr == pos_)
+            {
+                sink_.Int(value);
+                return;
+            }
+            // On overflow the number is read as double below
+        }
+        double value = 0.0;
+        if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc{} && ptr == pos_)
+        {
+            sink_.Double(value);
+            return;
+        }
+        throw ParsingError("Failed to convert "s + std::string(begin, pos_) + " to number in "s + __FUNCTION__);
+    }
+}
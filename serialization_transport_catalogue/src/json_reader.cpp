@@ -8,65 +8,120 @@ std::string ErrorMessage::what()
 	return what_;
 }
 
-domain::BaseRequest RequestReader::ParseStop(const json::Dict& dict)
+void RequestReader::CreateBaseRequest(const json::Document& doc)
 {
-	domain::BaseRequest temp;
-	temp.type = dict.at("type"s).AsString();
-	temp.name_stop = dict.at("name"s).AsString();
-	temp.latitude = dict.at("latitude"s).AsDouble();
-	temp.longitude = dict.at("longitude"s).AsDouble();
-	json::Dict distance_road = dict.at("road_distances"s).AsDict();
-	for (const auto& [name_stop, distance] : distance_road)
+	if (doc.GetRoot().AsDict().count("base_requests"s))
 	{
-		domain::NearestStop ns = { name_stop, distance.AsInt() };
-		temp.distance_to_nearest_stops.push_back(std::move(ns));
+		const json::Array& base_requests = doc.GetRoot().AsDict().at("base_requests"s).AsArray();
+
+		for (auto it = base_requests.begin(); it != base_requests.end(); ++it)
+		{
+			AddBaseRequest(*it);
+		}
 	}
-	return temp;
 }
 
-domain::BaseRequest RequestReader::ParseBus(const json::Dict& dict)
+// Collects the root dictionary except base_requests, whose elements are built one
+// at a time and handed over to the reader right away.
+class RequestReader::StreamingHandler final : public json::Handler
 {
-	domain::BaseRequest temp;
-	temp.type = dict.at("type"s).AsString();
-	temp.name_bus = dict.at("name"s).AsString();
-	temp.is_roundtrip = dict.at("is_roundtrip"s).AsBool();
-	json::Array stops = dict.at("stops"s).AsArray();
+public:
+	explicit StreamingHandler(RequestReader& reader)
+		: reader_(reader)
+	{
+	}
 
-	for (auto it = stops.begin(); it != stops.end(); ++it)
+	void StartDict() override
 	{
-		temp.stops_for_bus.push_back(it->AsString());
-		temp.name_last_stop = temp.stops_for_bus.back();
+		CheckBaseRequests();
+		GetTarget().StartDict();
+		++depth_;
 	}
-	if (!temp.is_roundtrip)
+
+	void EndDict() override
 	{
+		--depth_;
+		GetTarget().EndDict();
+		FlushElement();
+	}
 
-		temp.name_last_stop = temp.stops_for_bus.back();
-		temp.stops_for_bus.reserve(temp.stops_for_bus.size() * 2 - 1);
-		temp.stops_for_bus.insert(temp.stops_for_bus.end(),
-			std::next(temp.stops_for_bus.rbegin()), temp.stops_for_bus.rend());
+	void StartArray() override
+	{
+		if (in_base_requests_ && depth_ == 1)
+		{
+			++depth_;
+			return;
+		}
+		GetTarget().StartArray();
+		++depth_;
 	}
-	return temp;
-}
 
-void RequestReader::CreateBaseRequest(const json::Document& doc)
-{
-	if (doc.GetRoot().AsDict().count("base_requests"s))
+	void EndArray() override
+	{
+		--depth_;
+		if (in_base_requests_ && depth_ == 1)
+		{
+			in_base_requests_ = false;
+			return;
+		}
+		GetTarget().EndArray();
+		FlushElement();
+	}
+
+	void Key(std::string&& key) override
+	{
+		if (depth_ == 1 && key == "base_requests"s)
+		{
+			in_base_requests_ = true;
+			return;
+		}
+		GetTarget().Key(std::move(key));
+	}
+
+	void Value(json::Node&& value) override
 	{
-		json::Array base_requests = doc.GetRoot().AsDict().at("base_requests"s).AsArray();
+		CheckBaseRequests();
+		GetTarget().Value(std::move(value));
+		FlushElement();
+	}
 
-		for (auto it = base_requests.begin(); it != base_requests.end(); ++it)
+	json::Document ExtractDocument()
+	{
+		return json::Document{ root_.Extract() };
+	}
+
+private:
+	json::Handler& GetTarget()
+	{
+		if (in_base_requests_ && depth_ >= 2)
 		{
-			if (it->AsDict().at("type"s).AsString() == "Stop"s)
-			{
-				base_request_.push_back(std::move(ParseStop(it->AsDict())));
-			}
-			else if (it->AsDict().at("type"s).AsString() == "Bus"s)
-			{
-				base_request_.push_back(std::move(ParseBus(it->AsDict())));
-			}
+			return element_;
 		}
+		return root_;
 	}
-}
+
+	void CheckBaseRequests() const
+	{
+		if (in_base_requests_ && depth_ == 1)
+		{
+			throw json::ParsingError("base_requests should be an array in "s + __FUNCTION__);
+		}
+	}
+
+	void FlushElement()
+	{
+		if (element_.IsReady())
+		{
+			reader_.AddBaseRequest(element_.Extract());
+		}
+	}
+
+	RequestReader& reader_;
+	json::NodeBuilder root_;
+	json::NodeBuilder element_;
+	size_t depth_ = 0;
+	bool in_base_requests_ = false;
+};
 
 void RequestReader::CreateStatRequest(const json::Document& doc)
 {
@@ -145,7 +200,33 @@ void request::RequestReader::CreatePath(const json::Document& doc)
 	{
 		json::Dict serialization = doc.GetRoot().AsDict().at("serialization_settings"s).AsDict();
 		to_file_ = serialization.at("file").AsString();
+		if (serialization.count("format"s))
+		{
+			base_format_ = ParseBaseFormat(serialization.at("format"s).AsString());
+		}
+		if (serialization.count("map"s))
+		{
+			map_storage_ = ParseMapStorage(serialization.at("map"s).AsString());
+		}
+	}
+}
+
+domain::BaseFormat RequestReader::ParseBaseFormat(const std::string& format)
+{
+	if (format == "protobuf"s)
+	{
+		return domain::BaseFormat::PROTOBUF;
+	}
+	else if (format == "mapped"s)
+	{
+		return domain::BaseFormat::MAPPED;
 	}
+	std::string file = __FILE__;
+	std::string line = std::to_string(__LINE__);
+	std::string function = __FUNCTION__;
+	std::string error = "Incorrect base format '"s + format + "' in file: "s + file
+		+ " in fuction "s + function + " in line: "s + line;
+	throw ErrorMessage(error);
 }
 
 const request::RequestReader::Path request::RequestReader::GetPath() const noexcept
@@ -153,6 +234,110 @@ const request::RequestReader::Path request::RequestReader::GetPath() const noexc
 	return to_file_;
 }
 
+domain::BaseFormat request::RequestReader::GetBaseFormat() const noexcept
+{
+	return base_format_;
+}
+
+domain::MapStorage RequestReader::ParseMapStorage(const std::string& storage)
+{
+	if (storage == "none"s)
+	{
+		return domain::MapStorage::NONE;
+	}
+	else if (storage == "plain"s)
+	{
+		return domain::MapStorage::PLAIN;
+	}
+	else if (storage == "compressed"s)
+	{
+		return domain::MapStorage::COMPRESSED;
+	}
+	std::string file = __FILE__;
+	std::string line = std::to_string(__LINE__);
+	std::string function = __FUNCTION__;
+	std::string error = "Incorrect map storage '"s + storage + "' in file: "s + file
+		+ " in fuction "s + function + " in line: "s + line;
+	throw ErrorMessage(error);
+}
+
+domain::MapStorage request::RequestReader::GetMapStorage() const noexcept
+{
+	return map_storage_;
+}
+
+void RequestReader::CreateOutputSettings(const json::Document& doc)
+{
+	if (doc.GetRoot().AsDict().count("output_settings"s))
+	{
+		const json::Dict& output = doc.GetRoot().AsDict().at("output_settings"s).AsDict();
+		if (output.count("style"s))
+		{
+			print_style_ = ParsePrintStyle(output.at("style"s).AsString());
+		}
+	}
+}
+
+json::PrintStyle RequestReader::ParsePrintStyle(const std::string& style)
+{
+	if (style == "pretty"s)
+	{
+		return json::PrintStyle::PRETTY;
+	}
+	else if (style == "compact"s)
+	{
+		return json::PrintStyle::COMPACT;
+	}
+	std::string file = __FILE__;
+	std::string line = std::to_string(__LINE__);
+	std::string function = __FUNCTION__;
+	std::string error = "Incorrect output style '"s + style + "' in file: "s + file
+		+ " in fuction "s + function + " in line: "s + line;
+	throw ErrorMessage(error);
+}
+
+json::PrintStyle RequestReader::GetPrintStyle() const noexcept
+{
+	return print_style_;
+}
+
+void RequestReader::SetPrintStyle(json::PrintStyle style) noexcept
+{
+	print_style_ = style;
+}
+
+void RequestReader::CreateProcessSettings(const json::Document& doc)
+{
+	if (doc.GetRoot().AsDict().count("process_settings"s))
+	{
+		const json::Dict& process = doc.GetRoot().AsDict().at("process_settings"s).AsDict();
+		if (process.count("thread_count"s))
+		{
+			const int thread_count = process.at("thread_count"s).AsInt();
+			if (thread_count < 0)
+			{
+				std::string file = __FILE__;
+				std::string line = std::to_string(__LINE__);
+				std::string function = __FUNCTION__;
+				std::string error = "Incorrect thread count "s + std::to_string(thread_count) + " in file: "s + file
+					+ " in fuction "s + function + " in line: "s + line;
+				throw ErrorMessage(error);
+			}
+			thread_count_ = static_cast<size_t>(thread_count);
+		}
+	}
+}
+
+size_t RequestReader::GetThreadCount() const noexcept
+{
+	return thread_count_;
+}
+
+void RequestReader::SetThreadCount(size_t thread_count) noexcept
+{
+	thread_count_ = thread_count;
+}
+
 void RequestReader::CreateRenderSettings(const json::Document& doc)
 {
 	if (doc.GetRoot().AsDict().count("render_settings"s))
@@ -199,11 +384,43 @@ const renderer::RenderSettings& RequestReader::GetRendereSettings() const noexce
 	return render_settings_;
 }
 
-RequestReader::RequestReader(std::istream& in)
+RequestReader::RequestReader(std::istream& in, ReadMode mode)
 {
-	json::Document doc = json::Load(in);
+	json::Document doc = json::Document{ json::Node{} };
+	if (mode == ReadMode::STREAMING)
+	{
+		StreamingHandler handler(*this);
+		json::LoadEventsInChunks(in, handler);
+		doc = handler.ExtractDocument();
+	}
+	else if (mode == ReadMode::ARENA)
+	{
+		const json::ArenaDocument arena_doc(json::ReadInput(in));
+		json::Dict root;
+		for (const auto& [key, value] : arena_doc.GetRoot().AsDict())
+		{
+			if (key == "base_requests"sv)
+			{
+				for (const json::ArenaNode& request : value.AsArray())
+				{
+					AddBaseRequest(request);
+				}
+			}
+			else
+			{
+				root.emplace(std::string(key), value.ToNode());
+			}
+		}
+		doc = json::Document{ json::Node(std::move(root)) };
+	}
+	else
+	{
+		doc = json::Load(json::ReadInput(in));
+		CreateBaseRequest(doc);
+	}
 	CreatePath(doc);
-	CreateBaseRequest(doc);
+	CreateOutputSettings(doc);
+	CreateProcessSettings(doc);
 	CreateStatRequest(doc);
 	CreateRenderSettings(doc);
 	CreateRoutingSettings(doc);
@@ -216,6 +433,68 @@ void RequestReader::CreateRoutingSettings(const json::Document& doc)
 		json::Dict routing_settings = doc.GetRoot().AsDict().at("routing_settings"s).AsDict();
 		routing_settings_.bus_wait_time = routing_settings.at("bus_wait_time"s).AsInt();
 		routing_settings_.bus_velocity = routing_settings.at("bus_velocity"s).AsDouble();
+		if (routing_settings.count("router_mode"s))
+		{
+			routing_settings_.router_mode = ParseRouterMode(routing_settings.at("router_mode"s).AsString());
+		}
+		if (routing_settings.count("graph_model"s))
+		{
+			routing_settings_.graph_model = ParseGraphModel(routing_settings.at("graph_model"s).AsString());
+		}
+		if (routing_settings.count("route_cache_size"s))
+		{
+			const int route_cache_size = routing_settings.at("route_cache_size"s).AsInt();
+			if (route_cache_size < 0)
+			{
+				std::string file = __FILE__;
+				std::string line = std::to_string(__LINE__);
+				std::string function = __FUNCTION__;
+				std::string error = "Incorrect route cache size "s + std::to_string(route_cache_size) + " in file: "s + file
+					+ " in fuction "s + function + " in line: "s + line;
+				throw ErrorMessage(error);
+			}
+			routing_settings_.route_cache_size = static_cast<size_t>(route_cache_size);
+		}
+	}
+}
+
+domain::RouterMode RequestReader::ParseRouterMode(const std::string& mode)
+{
+	if (mode == "all_pairs"s)
+	{
+		return domain::RouterMode::ALL_PAIRS;
+	}
+	else if (mode == "dijkstra"s)
+	{
+		return domain::RouterMode::DIJKSTRA;
+	}
+	else if (mode == "contraction_hierarchy"s)
+	{
+		return domain::RouterMode::CONTRACTION_HIERARCHY;
+	}
+	std::string file = __FILE__;
+	std::string line = std::to_string(__LINE__);
+	std::string function = __FUNCTION__;
+	std::string error = "Incorrect router mode '"s + mode + "' in file: "s + file
+		+ " in fuction "s + function + " in line: "s + line;
+	throw ErrorMessage(error);
+}
+
+domain::GraphModel RequestReader::ParseGraphModel(const std::string& model)
+{
+	if (model == "complete"s)
+	{
+		return domain::GraphModel::COMPLETE;
+	}
+	else if (model == "split"s)
+	{
+		return domain::GraphModel::SPLIT;
 	}
+	std::string file = __FILE__;
+	std::string line = std::to_string(__LINE__);
+	std::string function = __FUNCTION__;
+	std::string error = "Incorrect graph model '"s + model + "' in file: "s + file
+		+ " in fuction "s + function + " in line: "s + line;
+	throw ErrorMessage(error);
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "json.h"
+#include "json_arena.h"
 #include "map_renderer.h"
 #include "domain.h"
 
@@ -20,6 +21,17 @@ private:
 
 namespace request
 {
+	// DOCUMENT loads the whole input into json nodes first, STREAMING reads the input
+	// in chunks and turns every element of base_requests into a BaseRequest as soon as
+	// it has been parsed, ARENA loads the input into a json::ArenaDocument and reads
+	// base_requests from it.
+	enum class ReadMode
+	{
+		DOCUMENT,
+		STREAMING,
+		ARENA
+	};
+
 	class RequestReader
 	{
 	public:
@@ -27,19 +39,29 @@ namespace request
 
 		RequestReader() = default;
 
-		explicit RequestReader(std::istream& in);
+		explicit RequestReader(std::istream& in, ReadMode mode = ReadMode::DOCUMENT);
 
 		void CreateRoutingSettings(const json::Document& doc);						
 
+		domain::RouterMode ParseRouterMode(const std::string& mode);
+
+		domain::GraphModel ParseGraphModel(const std::string& model);
+
 		void CreateBaseRequest(const json::Document& doc);		
 
+		// Node is json::Node or json::ArenaNode.
+		template <typename Node>
+		void AddBaseRequest(const Node& node);
+
 		void CreateStatRequest(const json::Document& doc);					
 
 		void CreateRenderSettings(const json::Document& doc);
 
-		inline domain::BaseRequest ParseStop(const json::Dict& dict);
+		template <typename Dict>
+		domain::BaseRequest ParseStop(const Dict& dict);
 
-		inline domain::BaseRequest ParseBus(const json::Dict& dict);
+		template <typename Dict>
+		domain::BaseRequest ParseBus(const Dict& dict);
 
 		const std::vector<domain::BaseRequest>& GetBaseRequest() const noexcept;
 
@@ -52,14 +74,101 @@ namespace request
 		svg::Color AddColor(const json::Node& node);
 
 		void CreatePath(const json::Document& doc);
+
+		domain::BaseFormat ParseBaseFormat(const std::string& format);
 		
 		const Path GetPath() const noexcept;		
 
+		domain::BaseFormat GetBaseFormat() const noexcept;
+
+		domain::MapStorage ParseMapStorage(const std::string& storage);
+
+		domain::MapStorage GetMapStorage() const noexcept;
+
+		void CreateOutputSettings(const json::Document& doc);
+
+		json::PrintStyle ParsePrintStyle(const std::string& style);
+
+		json::PrintStyle GetPrintStyle() const noexcept;
+
+		// Overrides output_settings, e.g. from the command line.
+		void SetPrintStyle(json::PrintStyle style) noexcept;
+
+		void CreateProcessSettings(const json::Document& doc);
+
+		// Number of threads building the route table and the map shapes or answering stat requests,
+		// 0 means one per hardware core.
+		size_t GetThreadCount() const noexcept;
+
+		// Overrides process_settings, e.g. from the command line.
+		void SetThreadCount(size_t thread_count) noexcept;
+
 	private:
+		class StreamingHandler;
+
 		Path to_file_;
+		domain::BaseFormat base_format_ = domain::BaseFormat::PROTOBUF;
+		domain::MapStorage map_storage_ = domain::MapStorage::NONE;
+		json::PrintStyle print_style_ = json::PrintStyle::PRETTY;
+		size_t thread_count_ = 1;
 		std::vector<domain::BaseRequest> base_request_;
 		std::vector<domain::StatRequest> stat_request_;
 		domain::RoutingSettings routing_settings_;
 		renderer::RenderSettings render_settings_;
 	};
+
+	template <typename Node>
+	void RequestReader::AddBaseRequest(const Node& node)
+	{
+		if (node.AsDict().at("type"s).AsString() == "Stop"s)
+		{
+			base_request_.push_back(ParseStop(node.AsDict()));
+		}
+		else if (node.AsDict().at("type"s).AsString() == "Bus"s)
+		{
+			base_request_.push_back(ParseBus(node.AsDict()));
+		}
+	}
+
+	template <typename Dict>
+	domain::BaseRequest RequestReader::ParseStop(const Dict& dict)
+	{
+		domain::BaseRequest temp;
+		temp.type = dict.at("type"s).AsString();
+		temp.name_stop = dict.at("name"s).AsString();
+		temp.latitude = dict.at("latitude"s).AsDouble();
+		temp.longitude = dict.at("longitude"s).AsDouble();
+		const auto& distance_road = dict.at("road_distances"s).AsDict();
+		for (const auto& [name_stop, distance] : distance_road)
+		{
+			domain::NearestStop ns = { std::string(name_stop), distance.AsInt() };
+			temp.distance_to_nearest_stops.push_back(std::move(ns));
+		}
+		return temp;
+	}
+
+	template <typename Dict>
+	domain::BaseRequest RequestReader::ParseBus(const Dict& dict)
+	{
+		domain::BaseRequest temp;
+		temp.type = dict.at("type"s).AsString();
+		temp.name_bus = dict.at("name"s).AsString();
+		temp.is_roundtrip = dict.at("is_roundtrip"s).AsBool();
+		const auto& stops = dict.at("stops"s).AsArray();
+
+		for (auto it = stops.begin(); it != stops.end(); ++it)
+		{
+			temp.stops_for_bus.emplace_back(it->AsString());
+			temp.name_last_stop = temp.stops_for_bus.back();
+		}
+		if (!temp.is_roundtrip)
+		{
+
+			temp.name_last_stop = temp.stops_for_bus.back();
+			temp.stops_for_bus.reserve(temp.stops_for_bus.size() * 2 - 1);
+			temp.stops_for_bus.insert(temp.stops_for_bus.end(),
+				std::next(temp.stops_for_bus.rbegin()), temp.stops_for_bus.rend());
+		}
+		return temp;
+	}
 }
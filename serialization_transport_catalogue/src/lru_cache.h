@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace lru_cache
+{
+
+    struct CacheStats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    // Keeps up to capacity values, evicting the least recently used one when full.
+    // All calls take a lock, so one cache can be shared by the threads of a pool.
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LruCache
+    {
+    public:
+        explicit LruCache(size_t capacity)
+            : capacity_(capacity)
+        {}
+
+        LruCache(const LruCache&) = delete;
+        LruCache& operator=(const LruCache&) = delete;
+
+        // Calls read(value) under the lock if the key is cached and marks the value as
+        // the most recently used one. Returns whether the key is cached.
+        template <typename Reader>
+        bool Read(const Key& key, Reader&& read)
+        {
+            std::lock_guard lock(mutex_);
+            const auto it = index_.find(key);
+            if (it == index_.end())
+            {
+                ++stats_.misses;
+                return false;
+            }
+            ++stats_.hits;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            read(std::as_const(it->second->second));
+            return true;
+        }
+
+        void Insert(const Key& key, Value value)
+        {
+            std::lock_guard lock(mutex_);
+            if (capacity_ == 0)
+            {
+                return;
+            }
+            if (const auto it = index_.find(key); it != index_.end())
+            {
+                it->second->second = std::move(value);
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return;
+            }
+            if (entries_.size() == capacity_)
+            {
+                // The node of the evicted value is reused for the new one
+                index_.erase(entries_.back().first);
+                entries_.splice(entries_.begin(), entries_, std::prev(entries_.end()));
+                entries_.front().first = key;
+                entries_.front().second = std::move(value);
+            }
+            else
+            {
+                entries_.emplace_front(key, std::move(value));
+            }
+            index_.emplace(key, entries_.begin());
+        }
+
+        CacheStats GetStats() const
+        {
+            std::lock_guard lock(mutex_);
+            return stats_;
+        }
+
+        size_t GetCapacity() const noexcept
+        {
+            return capacity_;
+        }
+
+    private:
+        using Entries = std::list<std::pair<Key, Value>>;
+
+        const size_t capacity_;
+        // The most recently used value goes first
+        Entries entries_;
+        std::unordered_map<Key, typename Entries::iterator, Hash> index_;
+        CacheStats stats_;
+        mutable std::mutex mutex_;
+    };
+
+}  // namespace lru_cache
@@ -1,5 +1,7 @@
+#include <charconv>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <string_view>
 #include "json_reader.h"
 #include "request_handler.h"
@@ -16,29 +18,80 @@ using namespace transport_catalogue;
 
 void PrintUsage(std::ostream& stream = std::cerr)
 {
-	stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+	stream << "Usage: transport_catalogue [make_base [--threads=N]|process_requests [--compact] [--threads=N]]\n"sv;
+}
+
+// Reads --threads=N
+std::optional<size_t> ParseThreadCount(std::string_view arg)
+{
+	const std::string_view flag = "--threads="sv;
+	if (arg.substr(0, flag.size()) != flag)
+	{
+		return std::nullopt;
+	}
+	arg.remove_prefix(flag.size());
+	size_t value = 0;
+	const auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+	if (ec != std::errc{} || ptr != arg.data() + arg.size())
+	{
+		return std::nullopt;
+	}
+	return value;
 }
 
 int main(int argc, char* argv[])
 {
-	if (argc != 2) 
+	if (argc < 2) 
 	{
 		PrintUsage();
 		return 1;
 	}
 
 	const std::string_view mode(argv[1]);
+	bool compact = false;
+	std::optional<size_t> thread_count;
+	for (int i = 2; i < argc; ++i)
+	{
+		const std::string_view arg(argv[i]);
+		if (mode == "process_requests"sv && arg == "--compact"sv)
+		{
+			compact = true;
+		}
+		else if (ParseThreadCount(arg))
+		{
+			thread_count = ParseThreadCount(arg);
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
 
 	if (mode == "make_base"sv) 
 	{
-		std::unique_ptr<request::RequestReader> rr = std::make_unique<request::RequestReader>(std::cin);
+		std::unique_ptr<request::RequestReader> rr
+			= std::make_unique<request::RequestReader>(std::cin, request::ReadMode::STREAMING);
+		if (thread_count)
+		{
+			rr->SetThreadCount(*thread_count);
+		}
 		std::unique_ptr<transport_catalogue::TransportCatalogue> tc
 			= std::make_unique<transport_catalogue::TransportCatalogue>(rr->GetBaseRequest());
 		std::unique_ptr<serialization::Serialization>serializ = std::make_unique< serialization::Serialization>(*rr, *tc);
 	}
 	else if (mode == "process_requests"sv)
 	{
-		std::unique_ptr<request::RequestReader> rr = std::make_unique<request::RequestReader>(std::cin);
+		std::unique_ptr<request::RequestReader> rr
+			= std::make_unique<request::RequestReader>(std::cin, request::ReadMode::ARENA);
+		if (compact)
+		{
+			rr->SetPrintStyle(json::PrintStyle::COMPACT);
+		}
+		if (thread_count)
+		{
+			rr->SetThreadCount(*thread_count);
+		}
 		std::unique_ptr<deserialization::Deserialization>deserializ = std::make_unique< deserialization::Deserialization>(*rr);
 		deserializ->PrintStatRequest();
 	}
@@ -1,6 +1,7 @@
 #include "map_renderer.h"
 
 using namespace renderer;
+using namespace std::literals;
 
 namespace sphere_projector
 {
@@ -8,6 +9,42 @@ namespace sphere_projector
 	{
 		return std::abs(value) < EPSILON;
 	}
+	SphereProjector::SphereProjector(const BoundingBox& box, double max_width, double max_height, double padding)
+		: padding_(padding)
+	{
+		if (box.empty)
+		{
+			return;
+		}
+		min_lon_ = box.min_lon;
+		max_lat_ = box.max_lat;
+
+		std::optional<double> width_zoom;
+		if (!IsZero(box.max_lon - box.min_lon))
+		{
+			width_zoom = (max_width - 2 * padding) / (box.max_lon - box.min_lon);
+		}
+
+		std::optional<double> height_zoom;
+		if (!IsZero(box.max_lat - box.min_lat))
+		{
+			height_zoom = (max_height - 2 * padding) / (box.max_lat - box.min_lat);
+		}
+
+		if (width_zoom && height_zoom)
+		{
+			zoom_coeff_ = std::min(*width_zoom, *height_zoom);
+		}
+		else if (width_zoom)
+		{
+			zoom_coeff_ = *width_zoom;
+		}
+		else if (height_zoom)
+		{
+			zoom_coeff_ = *height_zoom;
+		}
+	}
+
 	inline svg::Point SphereProjector::operator()(geo::Coordinates coords) const noexcept
 	{
 		return { (coords.lng - min_lon_) * zoom_coeff_ + padding_,
@@ -20,154 +57,91 @@ namespace sphere_projector
 
 namespace renderer
 {	
-	MapRenderer::MapRenderer(const RenderSettings& render_settings, const transport_catalogue::TransportCatalogue& tc) : settings_(render_settings)
+	MapRenderer::MapRenderer(const RenderSettings& render_settings, const transport_catalogue::TransportCatalogue& tc
+		, size_t thread_count) : settings_(render_settings)
 	{	
-		AddBusSvg(tc);
+		AddBusSvg(tc, thread_count);
 	}
 
-	MapRenderer MapRenderer::operator()(const renderer::RenderSettings& render_settings, const transport_catalogue::TransportCatalogue& tc)
+	MapRenderer& MapRenderer::operator()(const renderer::RenderSettings& render_settings, const transport_catalogue::TransportCatalogue& tc
+		, size_t thread_count)
 	{
 		settings_ = render_settings;
-		AddBusSvg(tc);
+		AddBusSvg(tc, thread_count);
 		return *this;
 	}
 
 	//------------------Add-----------------------	
 
-	 svg::Polyline MapRenderer::AddRouteBus(const transport_catalogue::Bus& bus, const svg::Color& color)noexcept
+	 void MapRenderer::FillBusSvg(BusSvg& bus_svg) const noexcept
 	{
-		svg::Polyline route_bus;
-		route_bus.SetStrokeColor(color);
-		route_bus.SetFillColor("none");
-		route_bus.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-		route_bus.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-		route_bus.SetStrokeWidth(settings_.line_width);
+		const transport_catalogue::Bus& bus = *bus_svg.bus;
+		bus_svg.route.reserve(bus.stops.size());
 		for (const auto& stop : bus.stops)
 		{
 			if (stop)
 			{
-				svg::Point point = s_({ stop->coordinates.lat, stop->coordinates.lng });
-				route_bus.AddPoint(point);
+				bus_svg.route.push_back(stop_points_[stop->id]);
 			}
 		}
-		return route_bus;
-	}	
-
-	 svg::Text MapRenderer::TextSvgForBus(const svg::Point& pos, const std::string& data)noexcept
-	{
-		return svg::Text().SetPosition(pos)
-			.SetOffset({ settings_.bus_label_offset.lat, settings_.bus_label_offset.lng })
-			.SetFontSize(settings_.bus_label_font_size)
-			.SetFontFamily("Verdana")
-			.SetFontWeight("bold")
-			.SetData(data);
-	}	
-
-	 svg::Text MapRenderer::CreateSVGTextForBus(const svg::Point& pos, const svg::Color& color, const std::string& data)noexcept
-	{
-		return TextSvgForBus(pos, data).SetFillColor(color);
-	}
-
-	 svg::Text MapRenderer::CreateSVGTextForBus(const svg::Point& pos, const std::string& data)noexcept
-	{
-		return TextSvgForBus(pos, data)
-			.SetFillColor(settings_.underlayer_color)
-			.SetStrokeColor(settings_.underlayer_color)
-			.SetStrokeWidth(settings_.underlayer_width)
-			.SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-			.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-	}
-
-	 std::vector<svg::Text> MapRenderer::AddNameBus(const transport_catalogue::Bus& bus, const svg::Color& color)noexcept
-	{		
-		std::vector<svg::Text>result;			
-
-		result.push_back(CreateSVGTextForBus(s_({ bus.stops.front()->coordinates.lat, bus.stops.front()->coordinates.lng }), bus.name));
-		result.push_back(CreateSVGTextForBus(s_({ bus.stops.front()->coordinates.lat, bus.stops.front()->coordinates.lng }), color, bus.name));
-
-		if (!bus.is_roundtrip && bus.stops[(bus.stops.size() + 1) / 2 - 1] != bus.stops[0])
-		{
-			result.push_back(CreateSVGTextForBus(s_({ bus.stops[(bus.stops.size() + 1) / 2 - 1]->coordinates.lat
-				, bus.stops[(bus.stops.size() + 1) / 2 - 1]->coordinates.lng }), bus.name));
-			result.push_back(CreateSVGTextForBus(s_({ bus.stops[(bus.stops.size() + 1) / 2 - 1]->coordinates.lat
-				, bus.stops[(bus.stops.size() + 1) / 2 - 1]->coordinates.lng }), color, bus.name));
-		}
-		return result;		
-	}
-
-	 svg::Text MapRenderer::TextSvgForStop( const svg::Point& pos, const std::string& data)noexcept
-	{
-		return svg::Text().SetPosition(pos)
-			.SetOffset({ settings_.stop_label_offset.lat, settings_.stop_label_offset.lng })
-			.SetFontSize(settings_.stop_label_font_size)
-			.SetFontFamily("Verdana")			
-			.SetData(data);
-	}
 
-	 svg::Text MapRenderer::CreateSVGTextForStop(const svg::Point& pos, const svg::Color& color, const std::string& data)noexcept
-	{
-		return TextSvgForStop(pos, data).SetFillColor(color);
-	}
-
-	 svg::Text MapRenderer::CreateSVGTextForStop(const svg::Point& pos, const std::string& data)noexcept
-	{
-		return TextSvgForStop( pos, data)
-			.SetFillColor(settings_.underlayer_color)
-			.SetStrokeColor(settings_.underlayer_color)
-			.SetStrokeWidth(settings_.underlayer_width)
-			.SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-			.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-	}
-
-	 std::vector<ShapeTextNameStop> MapRenderer::AddNameStops(const transport_catalogue::Bus& bus)noexcept
-	{		
-		std::vector<ShapeTextNameStop> result;
-		for (size_t i = 0; i < bus.stops.size() - 1; ++i)
+		bus_svg.labels.push_back(stop_points_[bus.stops.front()->id]);
+		const transport_catalogue::StopPtr last_stop = bus.stops[(bus.stops.size() + 1) / 2 - 1];
+		if (!bus.is_roundtrip && last_stop != bus.stops[0])
 		{
-			result.push_back({ bus.stops[i]->name 
-				, CreateSVGTextForStop( s_({ bus.stops[i]->coordinates.lat, bus.stops[i]->coordinates.lng }), "black", bus.stops[i]->name)
-				, CreateSVGTextForStop( s_({ bus.stops[i]->coordinates.lat, bus.stops[i]->coordinates.lng }),bus.stops[i]->name) });
+			bus_svg.labels.push_back(stop_points_[last_stop->id]);
 		}
-		return result;		
 	}
 
-	 std::vector<ShapeCircleStop> MapRenderer::AddCircleStops(const transport_catalogue::Bus& bus)noexcept
+	 void MapRenderer::AddBusSvg(const transport_catalogue::TransportCatalogue& tc, size_t thread_count)
 	{
-		std::vector<ShapeCircleStop> result;
-		for (size_t i = 0; i < bus.stops.size() - 1; ++i)
-		{
-			if (bus.stops[i])
+		InvalidateMap();
+		load_map_ = nullptr;
+		buses_.clear();
+		stops_.clear();
+
+		const std::vector<transport_catalogue::StopPtr> route_stops = GetRouteStops(tc);
+		SetSphereProjector(route_stops);
+		thread_pool::ThreadPool pool(thread_count);
+		stop_points_.assign(tc.GetStopCount(), {});
+		pool.ParallelFor(route_stops.size(), [this, &route_stops](size_t index)
 			{
-				svg::Circle circle;
-				circle.SetCenter(s_({ bus.stops[i]->coordinates.lat, bus.stops[i]->coordinates.lng }));
-				circle.SetRadius(settings_.stop_radius);
-				circle.SetFillColor("white");
-				result.push_back({ bus.stops[i]->name ,circle });
-			}
-		}
-		return result;
-	}
-
-	 void MapRenderer::AddBusSvg(const transport_catalogue::TransportCatalogue& tc)noexcept
-	{
-		SetSphereProjector(tc);
+				const transport_catalogue::StopPtr stop = route_stops[index];
+				stop_points_[stop->id] = s_(stop->coordinates);
+			});
 
-		std::vector<transport_catalogue::Bus>buses;
+		std::vector<transport_catalogue::BusPtr> buses;
+		buses.reserve(tc.GetBusCount());
 		for (const auto& bus : tc.GetRoute())
 		{
-			buses.push_back(bus);
+			buses.push_back(&bus);
 		}
 
-		sort(buses.begin(), buses.end(), [](const transport_catalogue::Bus& lhs, const transport_catalogue::Bus& rhs)
+		sort(buses.begin(), buses.end(), [](transport_catalogue::BusPtr lhs, transport_catalogue::BusPtr rhs)
 			{
-				return lhs.name < rhs.name;
+				return lhs->name < rhs->name;
 			});
+		std::vector<bool> added_stops(tc.GetStopCount());
 		size_t j = 0;
 		for (size_t i = 0; i < buses.size(); ++i)
 		{
-			if (buses[i].stops.size())
+			const auto& stops = buses[i]->stops;
+			if (stops.size())
 			{
-				PushBusSvg(buses[i], settings_.color_palette[j]);
+				// A bus of one stop takes its color but is not drawn
+				if (stops.size() > 1)
+				{
+					buses_.push_back({ buses[i], j });
+					// The last stop of the route is the first one or a stop met before
+					for (size_t k = 0; k + 1 < stops.size(); ++k)
+					{
+						if (stops[k] && !added_stops[stops[k]->id])
+						{
+							added_stops[stops[k]->id] = true;
+							stops_.push_back(stops[k]);
+						}
+					}
+				}
 
 				if (j == settings_.color_palette.size() - 1)
 				{
@@ -176,88 +150,133 @@ namespace renderer
 				++j;
 			}
 		}
-	}	
 
-	 void MapRenderer::PushBusSvg(const transport_catalogue::Bus& bus, const svg::Color& color)noexcept
-	{
-		buses_.push_back({ AddRouteBus(bus,color) ,AddNameBus(bus, color) ,AddCircleStops(bus) ,AddNameStops(bus) });
-	}
+		// With the colors picked the buses do not depend on each other, each one fills its own place
+		pool.ParallelFor(buses_.size(), [this](size_t index)
+			{
+				FillBusSvg(buses_[index]);
+			});
+		sort(stops_.begin(), stops_.end(), [](transport_catalogue::StopPtr lhs, transport_catalogue::StopPtr rhs)
+			{
+				return lhs->name < rhs->name;
+			});
+	}	
 
-	 void MapRenderer::SetSphereProjector(const transport_catalogue::TransportCatalogue& tc)noexcept
+	 std::vector<transport_catalogue::StopPtr> MapRenderer::GetRouteStops(const transport_catalogue::TransportCatalogue& tc)noexcept
 	{
-		std::vector<geo::Coordinates> minlon_maxlat;
+		// Every stop is taken once however many buses go through it
+		std::vector<bool> visited(tc.GetStopCount());
+		std::vector<transport_catalogue::StopPtr> result;
 		for (const auto& bus : tc.GetRoute())
 		{
 			for (const auto& stop : bus.stops)
 			{
-				if (stop)
+				if (stop && !visited[stop->id])
 				{
-					if (find(minlon_maxlat.begin(), minlon_maxlat.end(), stop->coordinates) == minlon_maxlat.end())
-					{
-						minlon_maxlat.push_back(stop->coordinates);
-					}
+					visited[stop->id] = true;
+					result.push_back(stop);
 				}
 			}
 		}
-		s_ = sphere_projector::SphereProjector(minlon_maxlat.begin(), minlon_maxlat.end(), settings_.width, settings_.height, settings_.padding);
+		return result;
+	}
+
+	 void MapRenderer::SetSphereProjector(const std::vector<transport_catalogue::StopPtr>& stops)noexcept
+	{
+		sphere_projector::BoundingBox box;
+		for (const transport_catalogue::StopPtr stop : stops)
+		{
+			box.Extend(stop->coordinates);
+		}
+		s_ = sphere_projector::SphereProjector(box, settings_.width, settings_.height, settings_.padding);
 	}
 
 	//----------Document to string--------------------------------------
 
-	 TempDocument MapRenderer::PrepareDocument(const std::vector<BusSvg>& buses) const noexcept
+	 svg::PathStyle MapRenderer::UnderlayerStyle() const
 	{
-		TempDocument temp;
-		for (const auto& bus : buses)
-		{
-			if (bus.shape_name_stops.size())
-			{
-				temp.shape_buses.push_back(bus.shape_route_bus);
+		return { settings_.underlayer_color, settings_.underlayer_color, settings_.underlayer_width
+			, svg::StrokeLineCap::ROUND, svg::StrokeLineJoin::ROUND };
+	}
 
-				for (const auto& n_bus : bus.shape_name_bus)
-				{
-					temp.shape_name_buses.push_back(n_bus);
-				}
+	 svg::FlatDocument::StyleId MapRenderer::AddBusLabelStyle(svg::FlatDocument& doc, const svg::PathStyle& style) const
+	{
+		return doc.AddTextStyle({ { settings_.bus_label_offset.lat, settings_.bus_label_offset.lng }
+			, settings_.bus_label_font_size, "Verdana"s, "bold"s }, style);
+	}
 
-				for (const auto& circle_stop : bus.shape_circle_stops)
-				{
-					temp.shape_circle_stops.insert({ circle_stop.name_stop, circle_stop.shape_stop });
-				}
-				for (const auto& name_stop : bus.shape_name_stops)
-				{
-					temp.shape_name_stops.insert({ name_stop.name_stop ,{name_stop.shape_name_stop, name_stop.shape_name_stop_substr } });
-				}
-			}
-		}
-		return temp;
+	 svg::FlatDocument::StyleId MapRenderer::AddStopLabelStyle(svg::FlatDocument& doc, const svg::PathStyle& style) const
+	{
+		return doc.AddTextStyle({ { settings_.stop_label_offset.lat, settings_.stop_label_offset.lng }
+			, settings_.stop_label_font_size, "Verdana"s, {} }, style);
 	}
 
 	 std::string MapRenderer::DocumentMapToString() const 
 	{
-		svg::Document doc;
+		svg::FlatDocument doc;
+		std::vector<svg::FlatDocument::StyleId> route_styles;
+		std::vector<svg::FlatDocument::StyleId> bus_label_styles;
+		for (const svg::Color& color : settings_.color_palette)
+		{
+			route_styles.push_back(doc.AddPolylineStyle({ "none"s, color, settings_.line_width
+				, svg::StrokeLineCap::ROUND, svg::StrokeLineJoin::ROUND }));
+			bus_label_styles.push_back(AddBusLabelStyle(doc, { color }));
+		}
+		const svg::FlatDocument::StyleId bus_underlayer_style = AddBusLabelStyle(doc, UnderlayerStyle());
+		const svg::FlatDocument::StyleId stop_style = doc.AddCircleStyle(settings_.stop_radius, { "white"s });
+		const svg::FlatDocument::StyleId stop_underlayer_style = AddStopLabelStyle(doc, UnderlayerStyle());
+		const svg::FlatDocument::StyleId stop_label_style = AddStopLabelStyle(doc, { "black"s });
 
-		for (const auto& line : PrepareDocument(buses_).shape_buses)
+		for (const BusSvg& bus : buses_)
 		{
-			doc.Add(line);
+			doc.AddPolyline(bus.route.begin(), bus.route.end(), route_styles[bus.color]);
 		}
-		for (const auto& text : PrepareDocument(buses_).shape_name_buses)
+		for (const BusSvg& bus : buses_)
 		{
-			doc.Add(text);
+			for (const svg::Point& label : bus.labels)
+			{
+				doc.AddText(label, bus.bus->name, bus_underlayer_style);
+				doc.AddText(label, bus.bus->name, bus_label_styles[bus.color]);
+			}
 		}
 
-		for (const auto& circle : PrepareDocument(buses_).shape_circle_stops)
+		for (const transport_catalogue::StopPtr stop : stops_)
 		{
-			doc.Add(circle.second);
+			doc.AddCircle(stop_points_[stop->id], stop_style);
 		}
 
-		for (const auto& stop : PrepareDocument(buses_).shape_name_stops)
+		for (const transport_catalogue::StopPtr stop : stops_)
 		{
-			doc.Add(stop.second.second);
-			doc.Add(stop.second.first);
+			doc.AddText(stop_points_[stop->id], stop->name, stop_underlayer_style);
+			doc.AddText(stop_points_[stop->id], stop->name, stop_label_style);
 		}
 
-		std::stringstream map;
+		std::string map;
 		doc.Render(map);
-		return map.str();
+		return map;
+	}
+
+	 const std::string& MapRenderer::GetMap() const
+	{
+		std::lock_guard lock(map_mutex_);
+		if (!map_)
+		{
+			map_ = load_map_ ? load_map_() : DocumentMapToString();
+		}
+		return *map_;
+	}
+
+	 void MapRenderer::InvalidateMap() noexcept
+	{
+		std::lock_guard lock(map_mutex_);
+		map_.reset();
+	}
+
+	 void MapRenderer::SetMapLoader(std::function<std::string()> load)
+	{
+		std::lock_guard lock(map_mutex_);
+		map_.reset();
+		load_map_ = std::move(load);
 	}
 
 	
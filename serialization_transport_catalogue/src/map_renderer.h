@@ -1,13 +1,18 @@
 #pragma once
 #include "svg.h"
+#include "svg_flat.h"
 #include "json.h"
 #include "transport_catalogue.h"
+#include "thread_pool.h"
 
 
 
 #include <sstream>
 #include <tuple>
 #include <algorithm>
+#include <functional>
+#include <mutex>
+#include <optional>
 
 
 
@@ -17,12 +22,39 @@ namespace sphere_projector
 
 	inline bool IsZero(double value) noexcept;
 
+	// Bounds of the points the projector maps into the picture.
+	struct BoundingBox
+	{
+		double min_lon = 0.;
+		double max_lon = 0.;
+		double min_lat = 0.;
+		double max_lat = 0.;
+		bool empty = true;
+
+		inline void Extend(geo::Coordinates coords) noexcept
+		{
+			if (empty)
+			{
+				min_lon = max_lon = coords.lng;
+				min_lat = max_lat = coords.lat;
+				empty = false;
+				return;
+			}
+			min_lon = std::min(min_lon, coords.lng);
+			max_lon = std::max(max_lon, coords.lng);
+			min_lat = std::min(min_lat, coords.lat);
+			max_lat = std::max(max_lat, coords.lat);
+		}
+	};
+
 	class SphereProjector
 	{
 	public:
 
 		SphereProjector() = default;
 
+		SphereProjector(const BoundingBox& box, double max_width, double max_height, double padding);
+
 		template <typename PointInputIt>
 		SphereProjector(PointInputIt points_begin, PointInputIt points_end, double max_width, double max_height, double padding);
 
@@ -36,73 +68,26 @@ namespace sphere_projector
 	};
 
 	template <typename PointInputIt>
-	SphereProjector::SphereProjector(PointInputIt points_begin, PointInputIt points_end, double max_width, double max_height, double padding)
-		: padding_(padding)
+	BoundingBox MakeBoundingBox(PointInputIt points_begin, PointInputIt points_end) noexcept
 	{
-		if (points_begin == points_end)
-		{
-			return;
-		}
-
-		const auto [left_it, right_it]
-			= std::minmax_element(points_begin, points_end, [](auto lhs, auto rhs)
-				{
-					return lhs.lng < rhs.lng;
-				});
-		min_lon_ = left_it->lng;
-		const double max_lon = right_it->lng;
-
-		const auto [bottom_it, top_it]
-			= std::minmax_element(points_begin, points_end, [](auto lhs, auto rhs)
-				{
-					return lhs.lat < rhs.lat;
-				});
-		const double min_lat = bottom_it->lat;
-		max_lat_ = top_it->lat;
-
-		std::optional<double> width_zoom;
-		if (!IsZero(max_lon - min_lon_))
-		{
-			width_zoom = (max_width - 2 * padding) / (max_lon - min_lon_);
-		}
-
-		std::optional<double> height_zoom;
-		if (!IsZero(max_lat_ - min_lat))
-		{
-			height_zoom = (max_height - 2 * padding) / (max_lat_ - min_lat);
-		}
-
-		if (width_zoom && height_zoom)
-		{
-			zoom_coeff_ = std::min(*width_zoom, *height_zoom);
-		}
-		else if (width_zoom)
-		{
-			zoom_coeff_ = *width_zoom;
-		}
-		else if (height_zoom)
+		BoundingBox box;
+		for (auto it = points_begin; it != points_end; ++it)
 		{
-			zoom_coeff_ = *height_zoom;
+			box.Extend(*it);
 		}
+		return box;
 	}
 
+	template <typename PointInputIt>
+	SphereProjector::SphereProjector(PointInputIt points_begin, PointInputIt points_end, double max_width, double max_height, double padding)
+		: SphereProjector(MakeBoundingBox(points_begin, points_end), max_width, max_height, padding)
+	{}
+
 }//namespace
 
 namespace renderer
 {
 	using NameStop = std::string;
-	using ShapesBusRout = std::vector<svg::Polyline>;
-	using ShapesBusName = std::vector<svg::Text>;
-	using MapShapeCircleStops = std::map<NameStop, svg::Circle>;
-	using MapShapeNameStops = std::map<NameStop, std::pair<svg::Text, svg::Text>>;
-
-	struct TempDocument
-	{
-		ShapesBusRout shape_buses;
-		ShapesBusName shape_name_buses;
-		MapShapeCircleStops shape_circle_stops;
-		MapShapeNameStops shape_name_stops;
-	};
 
 	struct RenderSettings
 	{
@@ -124,74 +109,79 @@ namespace renderer
 		std::vector<svg::Color> color_palette{};
 	};
 
-	struct ShapeTextNameStop
-	{
-		NameStop name_stop;
-		svg::Text shape_name_stop;
-		svg::Text shape_name_stop_substr;
-	};
-
-	struct ShapeCircleStop
-	{
-		NameStop name_stop;
-		svg::Circle shape_stop;
-	};
-
+	// Shapes of a bus with the points projected already.
 	struct BusSvg
 	{
-		svg::Polyline shape_route_bus;
-		ShapesBusName shape_name_bus;
-		std::vector<ShapeCircleStop> shape_circle_stops;
-		std::vector<ShapeTextNameStop> shape_name_stops;
+		const transport_catalogue::Bus* bus = nullptr;
+		// Index of the color of the bus in the palette
+		size_t color = 0;
+		std::vector<svg::Point> route{};
+		// The name is written at the first stop and, unless the bus is a roundtrip,
+		// at its last stop if that is another one
+		std::vector<svg::Point> labels{};
 	};
 
-
-
+	// The shapes refer to the buses and stops of the catalogue, which has to outlive the renderer.
 	class MapRenderer
 	{
 	public:
 
 		MapRenderer() = default;		
 		
-		explicit MapRenderer(const renderer::RenderSettings& render_settings, const transport_catalogue::TransportCatalogue& tc);
+		// thread_count is the number of threads building the shapes, 0 means one per hardware core.
+		explicit MapRenderer(const renderer::RenderSettings& render_settings, const transport_catalogue::TransportCatalogue& tc
+			, size_t thread_count = 1);
 
-		MapRenderer operator()(const renderer::RenderSettings& render_settings, const transport_catalogue::TransportCatalogue& tc);
+		MapRenderer(const MapRenderer&) = delete;
+		MapRenderer& operator=(const MapRenderer&) = delete;
 
-		inline svg::Polyline AddRouteBus(const transport_catalogue::Bus& bus, const svg::Color& color) noexcept;
+		// Rebuilds the shapes for new render settings or a changed catalogue and drops the rendered map.
+		MapRenderer& operator()(const renderer::RenderSettings& render_settings, const transport_catalogue::TransportCatalogue& tc
+			, size_t thread_count = 1);
 
-		inline svg::Text TextSvgForBus(const svg::Point& pos, const std::string& data) noexcept;
+		// Fills the route and labels of a bus taking the points of its stops from stop_points_.
+		inline void FillBusSvg(renderer::BusSvg& bus_svg) const noexcept;
 
-		inline svg::Text CreateSVGTextForBus(const svg::Point& pos, const svg::Color& color, const std::string& data) noexcept;
+		// Stops the buses go through, each one once.
+		static std::vector<transport_catalogue::StopPtr> GetRouteStops(const transport_catalogue::TransportCatalogue& tc) noexcept;
 
-		inline svg::Text CreateSVGTextForBus(const svg::Point& pos, const std::string& data) noexcept;
+		inline void SetSphereProjector(const std::vector<transport_catalogue::StopPtr>& stops) noexcept;
 
-		inline std::vector<svg::Text> AddNameBus(const transport_catalogue::Bus& bus, const svg::Color& color) noexcept;
+		inline void AddBusSvg(const transport_catalogue::TransportCatalogue& tc, size_t thread_count);
 
-		inline svg::Text TextSvgForStop(const svg::Point& pos, const std::string& data) noexcept;
+		inline svg::FlatDocument::StyleId AddBusLabelStyle(svg::FlatDocument& doc, const svg::PathStyle& style) const;
 
-		inline svg::Text CreateSVGTextForStop(const svg::Point& pos, const svg::Color& color, const std::string& data) noexcept;
+		inline svg::FlatDocument::StyleId AddStopLabelStyle(svg::FlatDocument& doc, const svg::PathStyle& style) const;
 
-		inline svg::Text CreateSVGTextForStop(const svg::Point& pos, const std::string& data) noexcept;
+		inline svg::PathStyle UnderlayerStyle() const;
 
-		inline std::vector<renderer::ShapeTextNameStop> AddNameStops(const transport_catalogue::Bus& bus) noexcept;
-
-		inline std::vector<renderer::ShapeCircleStop> AddCircleStops(const transport_catalogue::Bus& bus) noexcept;
-
-		inline void PushBusSvg(const transport_catalogue::Bus& bus, const svg::Color& color) noexcept;
-
-		inline void SetSphereProjector(const transport_catalogue::TransportCatalogue& tc) noexcept;
+		std::string DocumentMapToString()const ;
 
-		inline void AddBusSvg(const transport_catalogue::TransportCatalogue& tc) noexcept;
+		// The map rendered on the first call and kept until the shapes are rebuilt.
+		// Safe to call from several threads.
+		const std::string& GetMap() const;
 
-		inline renderer::TempDocument PrepareDocument(const std::vector<renderer::BusSvg>& buses)const noexcept;
+		// Drops the rendered map, the next GetMap renders it again.
+		void InvalidateMap() noexcept;
 
-		std::string DocumentMapToString()const ;
+		// Makes GetMap take the map from load instead of rendering the shapes, e.g. from a base
+		// file which has the map rendered already. load is called on the first GetMap only.
+		void SetMapLoader(std::function<std::string()> load);
 
 	private:
 
 		renderer::RenderSettings settings_;
 		sphere_projector::SphereProjector s_;
-		std::vector<renderer::BusSvg>buses_;
+		// Buses of two stops and more in the order of their names
+		std::vector<renderer::BusSvg> buses_;
+		// Stops of these buses in the order of their names
+		std::vector<transport_catalogue::StopPtr> stops_;
+		// Projected points of the stops the buses go through by stop id
+		std::vector<svg::Point> stop_points_;
+
+		mutable std::mutex map_mutex_;
+		mutable std::optional<std::string> map_;
+		std::function<std::string()> load_map_;
 	};
 
 }//namespace
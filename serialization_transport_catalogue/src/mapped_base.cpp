@@ -0,0 +1,174 @@
+#include "mapped_base.h"
+
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mapped_base
+{
+    namespace
+    {
+        constexpr size_t ALIGNMENT = 8;
+
+        size_t Align(size_t offset)
+        {
+            return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+    }
+
+    //----------------------class Writer
+
+    StringRef Writer::AddString(std::string_view str)
+    {
+        const StringRef ref{ static_cast<std::uint32_t>(strings_.size()), static_cast<std::uint32_t>(str.size()) };
+        strings_.append(str);
+        return ref;
+    }
+
+    void Writer::Save(const Path& path) const
+    {
+        constexpr size_t section_count = static_cast<size_t>(Section::COUNT);
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.section_count = section_count;
+
+        SectionEntry entries[section_count]{};
+        size_t offset = Align(sizeof(Header) + sizeof(entries));
+        for (size_t i = 0; i < section_count; ++i)
+        {
+            const bool is_strings = i == static_cast<size_t>(Section::STRINGS);
+            entries[i].offset = offset;
+            entries[i].size = is_strings ? strings_.size() : sections_[i].bytes.size();
+            entries[i].record_size = is_strings ? 1 : sections_[i].record_size;
+            offset = Align(offset + entries[i].size);
+        }
+
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+        {
+            throw std::runtime_error("Can not open base file " + path.string());
+        }
+        const char padding[ALIGNMENT]{};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries), sizeof(entries));
+        size_t written = sizeof(header) + sizeof(entries);
+        for (size_t i = 0; i < section_count; ++i)
+        {
+            out.write(padding, entries[i].offset - written);
+            const char* data = i == static_cast<size_t>(Section::STRINGS) ? strings_.data() : sections_[i].bytes.data();
+            out.write(data, entries[i].size);
+            written = entries[i].offset + entries[i].size;
+        }
+        if (!out)
+        {
+            throw std::runtime_error("Can not write base file " + path.string());
+        }
+    }
+
+    //----------------------class MappedFile
+
+#ifdef _WIN32
+    MappedFile::MappedFile(const Path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            throw std::runtime_error("Can not open base file " + path.string());
+        }
+        buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+
+    MappedFile::~MappedFile() = default;
+#else
+    MappedFile::MappedFile(const Path& path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Can not open base file " + path.string());
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Can not read base file " + path.string());
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ != 0)
+        {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("Can not map base file " + path.string());
+            }
+            data_ = static_cast<const char*>(data);
+        }
+        ::close(fd);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data_)
+        {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+    }
+#endif
+
+    //----------------------class Reader
+
+    Reader::Reader(const Path& path)
+        : file_(path)
+    {
+        constexpr size_t section_count = static_cast<size_t>(Section::COUNT);
+        const size_t table_end = sizeof(Header) + section_count * sizeof(SectionEntry);
+        if (file_.GetSize() < table_end)
+        {
+            throw std::runtime_error("Base file is too short");
+        }
+        const Header* header = reinterpret_cast<const Header*>(file_.GetData());
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+            || header->section_count != section_count)
+        {
+            throw std::runtime_error("Base file has unknown format");
+        }
+        entries_ = reinterpret_cast<const SectionEntry*>(file_.GetData() + sizeof(Header));
+        for (size_t i = 0; i < section_count; ++i)
+        {
+            if (entries_[i].offset % ALIGNMENT != 0 || entries_[i].offset > file_.GetSize()
+                || entries_[i].size > file_.GetSize() - entries_[i].offset)
+            {
+                throw std::runtime_error("Base file is corrupted");
+            }
+        }
+        const SectionEntry& strings = GetEntry(Section::STRINGS);
+        strings_ = { file_.GetData() + strings.offset, static_cast<size_t>(strings.size) };
+    }
+
+    const SectionEntry& Reader::GetEntry(Section section) const
+    {
+        return entries_[static_cast<size_t>(section)];
+    }
+
+    std::string_view Reader::GetString(StringRef ref) const
+    {
+        if (ref.offset > strings_.size() || ref.size > strings_.size() - ref.offset)
+        {
+            throw std::runtime_error("Base file is corrupted");
+        }
+        return strings_.substr(ref.offset, ref.size);
+    }
+}
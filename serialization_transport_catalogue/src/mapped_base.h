@@ -0,0 +1,227 @@
+#pragma once
+#include "ranges.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary base format that process_requests maps into memory and reads in place.
+//
+// The file starts with a Header followed by a table of SectionEntry, one per Section.
+// Every section is an 8-byte aligned array of plain records. The format is bound to the
+// architecture that wrote it: each section keeps the size of its record and a reader
+// refuses sections whose record size differs from its own.
+namespace mapped_base
+{
+    using Path = std::filesystem::path;
+
+    enum class Section : std::uint32_t
+    {
+        STRINGS,
+        STOPS,
+        BUSES,
+        BUS_STOPS,
+        DISTANCES,
+        BUS_STATS,
+        STOP_BUSES_OFFSETS,
+        STOP_BUSES,
+        RENDER_SETTINGS,
+        ROUTING_SETTINGS,
+        VERTICES,
+        STOP_VERTICES,
+        EDGES,
+        EDGES_INFO,
+        ROUTES,
+        HIERARCHY_EDGES,
+        HIERARCHY_UPWARD_OFFSETS,
+        HIERARCHY_UPWARD_EDGES,
+        HIERARCHY_DOWNWARD_OFFSETS,
+        HIERARCHY_DOWNWARD_EDGES,
+        // transport_catalogue_proto::RenderedMap, empty if the base has no rendered map
+        RENDERED_MAP,
+        COUNT
+    };
+
+    inline constexpr char MAGIC[8] = { 'T', 'C', 'B', 'A', 'S', 'E', '\0', '\0' };
+    inline constexpr std::uint32_t VERSION = 5;
+    inline constexpr std::uint32_t NO_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t section_count;
+    };
+
+    struct SectionEntry
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint32_t record_size;
+        std::uint32_t reserved;
+    };
+
+    // Piece of the STRINGS section.
+    struct StringRef
+    {
+        std::uint32_t offset;
+        std::uint32_t size;
+    };
+
+    struct StopRecord
+    {
+        StringRef name;
+        double latitude;
+        double longitude;
+    };
+
+    // Stops of the bus are BUS_STOPS[stops_begin, stops_end) given as indices in STOPS.
+    struct BusRecord
+    {
+        StringRef name;
+        StringRef name_last_stop;
+        std::uint32_t stops_begin;
+        std::uint32_t stops_end;
+        std::uint32_t is_roundtrip;
+        std::uint32_t reserved;
+    };
+
+    struct BusStatRecord
+    {
+        std::int32_t total_stops;
+        std::int32_t unique_stops;
+        double route_length;
+        std::int32_t distance;
+        std::uint32_t reserved;
+    };
+
+    struct DistanceRecord
+    {
+        std::uint32_t from;
+        std::uint32_t to;
+        std::int32_t distance;
+    };
+
+    struct RoutingRecord
+    {
+        std::int32_t bus_wait_time;
+        std::uint32_t router_mode;
+        double bus_velocity;
+        std::uint32_t graph_model;
+        std::uint32_t route_cache_size;
+    };
+
+    struct StopVertexRecord
+    {
+        std::uint32_t stop;
+        std::uint32_t vertex;
+    };
+
+    // Index of the bus in BUSES, NO_INDEX for a wait edge. An alight edge of the split
+    // graph model has zero span_count.
+    struct EdgeInfoRecord
+    {
+        std::uint32_t bus;
+        std::uint32_t span_count;
+    };
+
+    class Writer
+    {
+    public:
+        StringRef AddString(std::string_view str);
+
+        template <typename T>
+        void SetSection(Section section, const T* data, size_t count);
+
+        template <typename T>
+        void SetSection(Section section, const std::vector<T>& data)
+        {
+            SetSection(section, data.data(), data.size());
+        }
+
+        void Save(const Path& path) const;
+
+    private:
+        struct SectionData
+        {
+            std::vector<char> bytes;
+            std::uint32_t record_size = 1;
+        };
+
+        std::string strings_;
+        SectionData sections_[static_cast<size_t>(Section::COUNT)];
+    };
+
+    template <typename T>
+    void Writer::SetSection(Section section, const T* data, size_t count)
+    {
+        SectionData& section_data = sections_[static_cast<size_t>(section)];
+        const char* bytes = reinterpret_cast<const char*>(data);
+        section_data.bytes.assign(bytes, bytes + count * sizeof(T));
+        section_data.record_size = sizeof(T);
+    }
+
+    // Read-only view of the whole file, memory mapped where the platform allows.
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const Path& path);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile();
+
+        const char* GetData() const noexcept
+        {
+            return data_;
+        }
+
+        size_t GetSize() const noexcept
+        {
+            return size_;
+        }
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+#ifdef _WIN32
+        std::vector<char> buffer_;
+#endif
+    };
+
+    class Reader
+    {
+    public:
+        explicit Reader(const Path& path);
+
+        template <typename T>
+        ranges::Range<const T*> GetSection(Section section) const;
+
+        std::string_view GetString(StringRef ref) const;
+
+    private:
+        const SectionEntry& GetEntry(Section section) const;
+
+        MappedFile file_;
+        const SectionEntry* entries_ = nullptr;
+        std::string_view strings_;
+    };
+
+    template <typename T>
+    ranges::Range<const T*> Reader::GetSection(Section section) const
+    {
+        const SectionEntry& entry = GetEntry(section);
+        if (entry.size != 0 && entry.record_size != sizeof(T))
+        {
+            throw std::runtime_error("Base file was written on a different architecture");
+        }
+        const T* begin = reinterpret_cast<const T*>(file_.GetData() + entry.offset);
+        return { begin, begin + entry.size / sizeof(T) };
+    }
+}
@@ -1,5 +1,5 @@
 #include "request_handler.h"
-#include "json_builder.h"
+#include <algorithm>
 #include <fstream>
 
 using namespace std::literals;
@@ -20,238 +20,244 @@ RequestHandler::RequestHandler(const TransportCatalogue& db
 
 inline std::optional<BusStat> RequestHandler::GetBusStat(const std::string_view& bus_name) const noexcept
 {
-	std::optional<BusStat> result;
-	BusStat stat;
-	BusPtr bus = db_->FindBus(bus_name);
-	if (bus)
+	const std::optional<BusId> bus = db_->FindBusId(bus_name);
+	if (!bus)
 	{
-
-		std::unordered_set<std::string_view> seen_stops;
-
-		std::optional<Coordinates> prev_pos;
-
-		for (const auto& stop : bus->stops)
-		{
-			++stat.total_stops;
-
-			if (seen_stops.count(stop->name) == 0)
-			{
-				++stat.unique_stops;
-				seen_stops.insert(stop->name);
-			}
-
-			if (prev_pos)
-			{
-				stat.route_length += ComputeDistance(*prev_pos, stop->coordinates);
-			}
-
-			prev_pos = stop->coordinates;
-		}
-
-		for (auto it = bus->stops.begin(); it != bus->stops.end() - 1; ++it)
-		{
-			std::pair<StopPtr, StopPtr> temp{ *it, *(it + 1) };
-			stat.distance += db_->FindDistanceBetweenStops(std::move(temp));
-		}
-		result = std::move(stat);
+		return std::nullopt;
 	}
-	return result;
+	return db_->GetBusStat(*bus);
 }
 
 inline StopInfo RequestHandler::GetBusesByStop(const std::string_view& stop_name) const noexcept
 {
 	StopInfo result;
-	std::unordered_set<transport_catalogue::BusPtr> temp;
-	if (!db_->FindStop(stop_name))
+	const std::optional<StopId> stop = db_->FindStopId(stop_name);
+	if (!stop)
 	{
 		return StopInfo();
 	}
 
-	if (db_->GetStopToBuses().find(db_->FindStop(stop_name))->second.size())
-	{
-		result.buses_for_stop = db_->GetStopToBuses().find(db_->FindStop(stop_name))->second;
-		result.about = "Ok"s;
-	}
-	else
-	{
-		result.buses_for_stop = std::move(temp);
-		result.about = "no buses"s;
-	}
+	result.buses_for_stop = db_->GetBusesByStop(*stop);
+	result.about = result.buses_for_stop.begin() != result.buses_for_stop.end() ? "Ok"sv : "no buses"sv;
 	return result;
 }
 
+const std::string& RequestHandler::GetBusName(transport_catalogue::BusId bus) const
+{
+	return db_->GetBusById(bus).name;
+}
+
 const transport_router::TransportRouter& RequestHandler::GetTransportRouter() const noexcept
 {
 	return *tr_;
 }
 
-std::optional<std::string> RequestHandler::GetMap() const noexcept
+const std::string& RequestHandler::GetMap() const
 {
-	return renderer_->DocumentMapToString();
+	return renderer_->GetMap();
 }
 
 
 namespace stat_request
 {
 
-	inline json::Node MessageErrore(const domain::StatRequest& stat) noexcept
+	inline void MessageErrore(const domain::StatRequest& stat, json::Writer& writer)
 	{
-		return json::Builder{}
-			.StartDict()
-			.Key("request_id"s).Value(stat.id_request)
-			.Key("error_message"s).Value("not found"s)
-			.EndDict()
-			.Build();
+		writer.StartDict()
+			.Key("error_message"sv).Value("not found"sv)
+			.Key("request_id"sv).Value(stat.id_request)
+			.EndDict();
 	}
 
-	inline json::Node RepareReportRouter(const domain::StatRequest& stat, const std::optional<transport_router::TransportRouter::RouteInfo>& reports) noexcept
+	inline void RepareReportRouter(const domain::StatRequest& stat, const transport_router::TransportRouter::RouteView& reports, json::Writer& writer)
 	{
-		json::Builder report;
-		report.StartDict().Key("items"s).StartArray();
-		for (const auto& route : reports->items)
+		writer.StartDict().Key("items"sv).StartArray();
+		for (const auto& route : reports.legs)
 		{
-			if (std::holds_alternative<transport_router::TransportRouter::RouteInfo::WaitItem>(route))
+			if (const auto* wait = std::get_if<transport_router::TransportRouter::RouteView::WaitLeg>(&route))
 			{
-				transport_router::TransportRouter::RouteInfo::WaitItem wait = std::get<transport_router::TransportRouter::RouteInfo::WaitItem>(route);
-				report.StartDict().Key("stop_name"s).Value(std::move(std::string(wait.stop_name)))
-					.Key("time"s).Value(wait.time)
-					.Key("type"s).Value("Wait"s)
-					.EndDict().StartDict();
+				writer.StartDict()
+					.Key("stop_name"sv).Value(wait->stop_name)
+					.Key("time"sv).Value(wait->time)
+					.Key("type"sv).Value("Wait"sv)
+					.EndDict();
 			}
-			else if (std::holds_alternative<transport_router::TransportRouter::RouteInfo::BusItem>(route))
+			else if (const auto* bus = std::get_if<transport_router::TransportRouter::RouteView::BusLeg>(&route))
 			{
-				transport_router::TransportRouter::RouteInfo::BusItem bus = std::get<transport_router::TransportRouter::RouteInfo::BusItem>(route);
-				report.Key("bus"s).Value(std::move(std::string(bus.bus_name)))
-					.Key("span_count"s).Value(bus.span_count)
-					.Key("time"s).Value(bus.time)
-					.Key("type"s).Value("Bus"s)
+				writer.StartDict()
+					.Key("bus"sv).Value(bus->bus_name)
+					.Key("span_count"sv).Value(bus->span_count)
+					.Key("time"sv).Value(bus->time)
+					.Key("type"sv).Value("Bus"sv)
 					.EndDict();
 			}
-
 		}
-		return report.EndArray()
-			.Key("request_id"s).Value(stat.id_request)
-			.Key("total_time"s).Value(reports->total_time).EndDict().Build();
+		writer.EndArray()
+			.Key("request_id"sv).Value(stat.id_request)
+			.Key("total_time"sv).Value(reports.total_time)
+			.EndDict();
 	}
 
-	inline json::Node RepareMap(const RequestHandler& rh, const domain::StatRequest& stat) noexcept
+	inline void RepareMap(const std::string& map, const domain::StatRequest& stat, json::Writer& writer)
 	{
-		return json::Builder{}.StartDict()
-			.Key("map"s).Value(std::move(*rh.GetMap()))
-			.Key("request_id"s).Value(stat.id_request).EndDict().Build();
+		writer.StartDict()
+			.Key("map"sv).Value(map)
+			.Key("request_id"sv).Value(stat.id_request)
+			.EndDict();
 	}
 
-	inline json::Node RepareReportStop(const transport_catalogue::StopInfo& stop, const domain::StatRequest& stat) noexcept
+	inline void RepareReportStop(const RequestHandler& rh, const transport_catalogue::StopInfo& stop, const domain::StatRequest& stat, json::Writer& writer)
 	{
-		std::set<std::string>name_bus;
-		for (const auto& buses : stop.buses_for_stop)
-		{
-			name_bus.insert(buses->name);
-		}
+		writer.StartDict()
+			.Key("buses"sv).StartArray();
 
-		json::Builder answer_stop;
-		answer_stop.StartDict()
-			.Key("buses"s).StartArray();
-
-		for (auto name : name_bus)
+		for (const transport_catalogue::BusId bus : stop.buses_for_stop)
 		{
-			answer_stop.Value(std::move(name));
+			writer.Value(rh.GetBusName(bus));
 		}
 
-		return answer_stop.EndArray()
-			.Key("request_id"s).Value(stat.id_request)
-			.EndDict().Build();
+		writer.EndArray()
+			.Key("request_id"sv).Value(stat.id_request)
+			.EndDict();
 	}
 
-	inline json::Node RepareReportBus(const transport_catalogue::BusStat& bus, const domain::StatRequest& stat) noexcept
+	inline void RepareReportBus(const transport_catalogue::BusStat& bus, const domain::StatRequest& stat, json::Writer& writer)
 	{
-		return json::Builder{}
-			.StartDict()
-			.Key("curvature"s).Value(bus.distance / bus.route_length)
-			.Key("request_id"s).Value(stat.id_request)
-			.Key("route_length"s).Value(bus.distance)
-			.Key("stop_count"s).Value(bus.total_stops)
-			.Key("unique_stop_count"s).Value(bus.unique_stops)
-			.EndDict()
-			.Build();
+		writer.StartDict()
+			.Key("curvature"sv).Value(bus.distance / bus.route_length)
+			.Key("request_id"sv).Value(stat.id_request)
+			.Key("route_length"sv).Value(bus.distance)
+			.Key("stop_count"sv).Value(bus.total_stops)
+			.Key("unique_stop_count"sv).Value(bus.unique_stops)
+			.EndDict();
 	}
 
-	inline void StatRequestStop(const RequestHandler& rh, const domain::StatRequest& stat, json::Array& answers) noexcept
+	inline Answer StatRequestStop(const RequestHandler& rh, const domain::StatRequest& stat)
 	{
 		const transport_catalogue::StopInfo& stop = rh.GetBusesByStop(stat.name_type);
-		if (stop.about == "not found"s)
-		{
-			answers.emplace_back(std::move(MessageErrore(stat)));
-		}
-		else
+		if (stop.about == "not found"sv)
 		{
-			answers.emplace_back(std::move(RepareReportStop(stop, stat)));
+			return {};
 		}
+		return stop;
 	}
 
-	inline void StatRequestBus(const RequestHandler& rh, const domain::StatRequest& stat, json::Array& answers) noexcept
+	inline Answer StatRequestBus(const RequestHandler& rh, const domain::StatRequest& stat)
 	{
 		const std::optional<transport_catalogue::BusStat>& bus_stat = rh.GetBusStat(stat.name_type);
 		if (bus_stat)
 		{
-			answers.emplace_back(std::move(RepareReportBus(bus_stat.value(), stat)));
+			return *bus_stat;
 		}
-		else
+		return {};
+	}
+	
+	inline void StatRequestRoute(const RequestHandler& rh, const domain::StatRequest& stat, Answer& answer)
+	{
+		using RouteView = transport_router::TransportRouter::RouteView;
+		const transport_router::TransportRouter& tr = rh.GetTransportRouter();
+		const std::optional<graph::VertexId> from = tr.FindStopVertex(stat.from);
+		const std::optional<graph::VertexId> to = tr.FindStopVertex(stat.to);
+		if (!from || !to)
 		{
-			answers.emplace_back(std::move(MessageErrore(stat)));
+			answer = std::monostate{};
+			return;
+		}
+		RouteView* route = std::get_if<RouteView>(&answer);
+		if (!route)
+		{
+			route = &answer.emplace<RouteView>();
+		}
+		if (!tr.FindRoute(*from, *to, *route))
+		{
+			answer = std::monostate{};
 		}
 	}
-	
-	inline void StatRequestRoute(const RequestHandler& rh, const domain::StatRequest& stat, json::Array& answers) noexcept
+
+	inline void ComputeAnswer(const RequestHandler& rh, const domain::StatRequest& stat, Answer& answer)
 	{
-		const std::optional<transport_router::TransportRouter::RouteInfo>& reports = rh.GetTransportRouter().FindRoute(stat.from, stat.to);
-		if (reports)
+		if (stat.type == "Bus"s)
 		{
-			answers.emplace_back(std::move(RepareReportRouter(stat, reports)));
+			answer = StatRequestBus(rh, stat);
+			return;
+		}
+		else if (stat.type == "Stop"s)
+		{
+			answer = StatRequestStop(rh, stat);
+			return;
+		}
+		else if (stat.type == "Map"s)
+		{				
+			answer = std::cref(rh.GetMap());
+			return;
+		}
+		else if (stat.type == "Route"s)
+		{
+			StatRequestRoute(rh, stat, answer);
+			return;
+		}
+		std::string file = __FILE__;
+		std::string line = std::to_string(__LINE__);
+		std::string function = __FUNCTION__;
+		std::string error = "Incorrect input stat request in file: "s + file
+			+ " in fuction "s + function + " in line: "s + line;
+		throw ErrorMessage(error);
+	}
+
+	inline void WriteAnswer(const RequestHandler& rh, const domain::StatRequest& stat, const Answer& answer, json::Writer& writer)
+	{
+		if (const auto* bus = std::get_if<transport_catalogue::BusStat>(&answer))
+		{
+			RepareReportBus(*bus, stat, writer);
+		}
+		else if (const auto* stop = std::get_if<transport_catalogue::StopInfo>(&answer))
+		{
+			RepareReportStop(rh, *stop, stat, writer);
+		}
+		else if (const auto* route = std::get_if<transport_router::TransportRouter::RouteView>(&answer))
+		{
+			RepareReportRouter(stat, *route, writer);
+		}
+		else if (const auto* map = std::get_if<std::reference_wrapper<const std::string>>(&answer))
+		{
+			RepareMap(map->get(), stat, writer);
 		}
 		else
 		{
-			answers.emplace_back(std::move(MessageErrore(stat)));
+			MessageErrore(stat, writer);
 		}
 	}
 
-	inline json::Document PrepareDocument(const RequestHandler& rh, const std::vector<domain::StatRequest>& stat_requests)
+	inline void WriteAnswers(const RequestHandler& rh, const std::vector<domain::StatRequest>& stat_requests, json::Writer& writer
+		, thread_pool::ThreadPool& pool)
 	{
-		json::Array answers;
-		for (const auto& stat : stat_requests)
+		constexpr size_t batch_size_per_thread = 64;
+		const size_t batch_size = pool.GetThreadCount() * batch_size_per_thread;
+		// Kept between batches so that the route answers reuse their memory
+		std::vector<Answer> answers;
+
+		writer.StartArray();
+		for (size_t batch_begin = 0; batch_begin < stat_requests.size(); batch_begin += batch_size)
 		{
-			if (stat.type == "Bus"s)
+			const size_t count = std::min(batch_size, stat_requests.size() - batch_begin);
+			answers.resize(count);
+			pool.ParallelFor(count, [&](size_t index)
+				{
+					ComputeAnswer(rh, stat_requests[batch_begin + index], answers[index]);
+				});
+			for (size_t index = 0; index < count; ++index)
 			{
-				StatRequestBus(rh, stat, answers);
+				WriteAnswer(rh, stat_requests[batch_begin + index], answers[index], writer);
 			}
-			else if (stat.type == "Stop"s)
-			{
-				StatRequestStop(rh, stat, answers);
-			}
-			else if (stat.type == "Map"s)
-			{				
-				answers.emplace_back(std::move(RepareMap(rh, stat)));
-			}
-			else if (stat.type == "Route"s)
-			{
-				StatRequestRoute(rh, stat, answers);
-			}
-			else
-			{
-				std::string file = __FILE__;
-				std::string line = std::to_string(__LINE__);
-				std::string function = __FUNCTION__;
-				std::string error = "Incorrect input stat request in file: "s + file
-					+ " in fuction "s + function + " in line: "s + line;
-				throw ErrorMessage(error);
-			}
-		}		
-		
-		return json::Document(std::move(json::Node(std::move(answers))));
+		}
+		writer.EndArray();
 	}
 
-	void PrintStatDoc(const RequestHandler& rh, const std::vector<domain::StatRequest>& stat_requests, std::ostream& out) noexcept
+	void PrintStatDoc(const RequestHandler& rh, const std::vector<domain::StatRequest>& stat_requests, std::ostream& out
+		, json::PrintStyle style, size_t thread_count)
 	{			
-		json::Print(PrepareDocument(rh, stat_requests), out);		
+		thread_pool::ThreadPool pool(thread_count);
+		json::Writer writer(out, style);
+		WriteAnswers(rh, stat_requests, writer, pool);
 	}
 }//namespace stat_request
@@ -3,7 +3,10 @@
 #include "map_renderer.h"
 #include "domain.h"
 #include "transport_router.h"
+#include "thread_pool.h"
+#include <functional>
 #include <optional>
+#include <variant>
 
 
 class RequestHandler
@@ -20,9 +23,12 @@ public:
 
     transport_catalogue::StopInfo GetBusesByStop(const std::string_view& stop_name) const noexcept;
 
+    const std::string& GetBusName(transport_catalogue::BusId bus) const;
+
     const transport_router::TransportRouter& GetTransportRouter() const noexcept;
 
-    std::optional<std::string> GetMap() const noexcept;
+    // Rendered once and shared by all the Map requests.
+    const std::string& GetMap() const;
     
 private:
     const transport_catalogue::TransportCatalogue* db_;
@@ -34,23 +40,40 @@ private:
 
 namespace stat_request
 {
-    inline json::Node MessageErrore(const domain::StatRequest& stat) noexcept;
+    // Result of one stat request: std::monostate if the object is not found,
+    // the svg text of the renderer for a map. Routes refer to the names kept by the router.
+    using Answer = std::variant<std::monostate, transport_catalogue::BusStat, transport_catalogue::StopInfo
+        , transport_router::TransportRouter::RouteView, std::reference_wrapper<const std::string>>;
+
+    inline void MessageErrore(const domain::StatRequest& stat, json::Writer& writer);
+
+    inline void RepareReportRouter(const domain::StatRequest& stat, const transport_router::TransportRouter::RouteView& reports, json::Writer& writer);
+
+    inline void RepareMap(const std::string& map, const domain::StatRequest& stat, json::Writer& writer);
 
-    inline json::Node RepareReportRouter(const domain::StatRequest& stat, const std::optional<transport_router::TransportRouter::RouteInfo>& reports) noexcept;
+    inline void RepareReportStop(const RequestHandler& rh, const transport_catalogue::StopInfo& stop, const domain::StatRequest& stat, json::Writer& writer);
 
-    inline json::Node RepareMap(const RequestHandler& rh, const domain::StatRequest& stat) noexcept;
+    inline void RepareReportBus(const transport_catalogue::BusStat& bus, const domain::StatRequest& stat, json::Writer& writer);
 
-    inline json::Node RepareReportStop(const transport_catalogue::StopInfo& stop, const domain::StatRequest& stat) noexcept;
+    inline Answer StatRequestStop(const RequestHandler& rh, const domain::StatRequest& stat);
 
-    inline json::Node RepareReportBus(const transport_catalogue::BusStat& bus, const domain::StatRequest& stat) noexcept;
+    inline Answer StatRequestBus(const RequestHandler& rh, const domain::StatRequest& stat);
 
-    inline json::Document PrepareDocument(const RequestHandler& rh, const std::vector<domain::StatRequest>& stat_requests);
+    // Reuses the memory of the route answer is holding, if any.
+    inline void StatRequestRoute(const RequestHandler& rh, const domain::StatRequest& stat, Answer& answer);
 
-    inline void StatRequestStop(const RequestHandler& rh, const domain::StatRequest& stat, json::Array& answers) noexcept;
+    // Answers kept from a previous request are overwritten in place.
+    inline void ComputeAnswer(const RequestHandler& rh, const domain::StatRequest& stat, Answer& answer);
 
-    inline void StatRequestBus(const RequestHandler& rh, const domain::StatRequest& stat, json::Array& answers) noexcept;
+    inline void WriteAnswer(const RequestHandler& rh, const domain::StatRequest& stat, const Answer& answer, json::Writer& writer);
 
-    inline void StatRequestRoute(const RequestHandler& rh, const domain::StatRequest& stat, json::Array& answers) noexcept;
+    // Answers are computed in batches, concurrently if there is more than one thread,
+    // and each batch is written in the order of the requests as soon as it is done,
+    // so memory does not grow with the number of requests. Keys go in alphabetical order.
+    inline void WriteAnswers(const RequestHandler& rh, const std::vector<domain::StatRequest>& stat_requests, json::Writer& writer
+        , thread_pool::ThreadPool& pool);
 
-	void PrintStatDoc(const RequestHandler& rh, const std::vector<domain::StatRequest>& stat_requests, std::ostream& out = std::cout) noexcept;
+	// thread_count 0 means one thread per hardware core.
+	void PrintStatDoc(const RequestHandler& rh, const std::vector<domain::StatRequest>& stat_requests, std::ostream& out = std::cout
+		, json::PrintStyle style = json::PrintStyle::PRETTY, size_t thread_count = 1);
 }//namespace
\ No newline at end of file
@@ -1,17 +1,32 @@
 #pragma once
 #include "graph.h"
 #include "log_duration.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
+#include <queue>
 #include <stdexcept>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+// The relaxation kernel is compiled for AVX2 as well where the toolchain can pick the
+// variant at run time, the binary keeps running on processors without it. The ivdep
+// pragma of its loop is for GCC too, MSVC and clang warn about an unknown pragma.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define ROUTER_KERNEL_TARGETS __attribute__((target_clones("avx2", "default")))
+#define ROUTER_KERNEL_IVDEP _Pragma("GCC ivdep")
+#else
+#define ROUTER_KERNEL_TARGETS
+#define ROUTER_KERNEL_IVDEP
+#endif
+
 namespace graph 
 {
 
@@ -23,20 +38,47 @@ namespace graph
         
 
     public:
+        // One cell of the route table: weight of the best route and the last edge on it.
+        // Unreachable cells hold UNREACHABLE weight, the route to itself has no prev edge.
         struct RouteInternalData
         {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
+            float weight;
+            std::uint32_t prev_edge;
         };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+        static_assert(sizeof(RouteInternalData) == 8, "Route table cell should be packed into 8 bytes");
+
+        // Row-major source_count x vertex_count table, cell [from * vertex_count + to].
+        // Routes start at the first source_count vertices, all of them by default.
+        using RoutesInternalData = std::vector<RouteInternalData>;
+
+        static constexpr float UNREACHABLE = std::numeric_limits<float>::infinity();
+        static constexpr std::uint32_t NO_EDGE = std::numeric_limits<std::uint32_t>::max();
 
         explicit Router(const Graph& graph);
 
-        explicit Router(const Graph& graph, RoutesInternalData&& data); 
+        // Builds the same table as Router(graph) on the threads of the pool. Relaxations
+        // are grouped by blocks of intermediate vertices so that every row stays in cache
+        // for a whole block.
+        Router(const Graph& graph, thread_pool::ThreadPool& pool);
+
+        // Builds the rows of the first source_count vertices only, each one by Dijkstra from
+        // its vertex on a thread of the pool. Suits graphs with many more vertices than route ends.
+        Router(const Graph& graph, size_t source_count, thread_pool::ThreadPool& pool);
+
+        explicit Router(const Graph& graph, RoutesInternalData&& data, size_t source_count);
+
+        // Uses a table of route_count cells owned by someone else (e.g. a mapped base file),
+        // it must outlive the router.
+        explicit Router(const Graph& graph, const RouteInternalData* routes, size_t route_count, size_t source_count);
+
+        Router(const Router&) = delete;
+        Router(Router&&) = default;
+        Router& operator=(const Router&) = delete;
         
-        RoutesInternalData GetRouterData() const noexcept
+        ranges::Range<const RouteInternalData*> GetRouterData() const noexcept
         {
-            return routes_internal_data_;
+            const size_t vertex_count = graph_.GetVertexCount();
+            return { routes_, routes_ + source_count_ * vertex_count };
         }
 
         
@@ -49,14 +91,33 @@ namespace graph
 
         std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+        // Writes the edges of the route into edges and returns its weight. Nothing is
+        // allocated once edges has the capacity for the route.
+        std::optional<Weight> BuildRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const;
+
     private:
-        
-        void InitializeRoutesInternalData(const Graph& graph)
+        // Dense vertex_count x vertex_count matrix the table is built in: weights are relaxed
+        // in full precision, INFINITE_WEIGHT marks unreachable cells, and the last edges
+        // of the routes are kept in a separate array of the same layout. The table is packed
+        // into RouteInternalData only at the end.
+        struct BuildMatrix
+        {
+            explicit BuildMatrix(size_t vertex_count)
+                : weights(vertex_count * vertex_count, INFINITE_WEIGHT)
+                , prev_edges(vertex_count * vertex_count, NO_EDGE)
+            {
+            }
+
+            std::vector<Weight> weights;
+            std::vector<std::uint32_t> prev_edges;
+        };
+
+        void InitializeRoutesInternalData(const Graph& graph, BuildMatrix& routes) const
         {
             const size_t vertex_count = graph.GetVertexCount();
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
             {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+                routes.weights[vertex * vertex_count + vertex] = ZERO_WEIGHT;
                 for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
                 {
                     const auto& edge = graph.GetEdge(edge_id);
@@ -64,88 +125,287 @@ namespace graph
                     {
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight)
+                    if (edge_id >= NO_EDGE)
                     {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                        throw std::length_error("Too many edges for the route table");
+                    }
+                    const size_t cell = vertex * vertex_count + edge.to;
+                    if (routes.weights[cell] > edge.weight)
+                    {
+                        routes.weights[cell] = edge.weight;
+                        routes.prev_edges[cell] = static_cast<std::uint32_t>(edge_id);
                     }
                 }
             }
         }
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-            const RouteInternalData& route_to) 
+        // Relaxes routes from one vertex via vertex_through, the *_through rows hold the routes from it.
+        //
+        // The loop has no branches and is vectorized by the compiler. A route through the vertex
+        // never ends with a route of its own row which has no prev edge: the only such reachable
+        // cell is the zero route to itself, and adding it never makes a route strictly shorter.
+        ROUTER_KERNEL_TARGETS
+        static void RelaxRowThroughVertex(Weight* weights_from, std::uint32_t* prev_edges_from
+            , const Weight* weights_through, const std::uint32_t* prev_edges_through
+            , size_t vertex_count, VertexId vertex_through)
         {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight)
+            const Weight weight_from = weights_from[vertex_through];
+            if (weight_from == INFINITE_WEIGHT)
+            {
+                return;
+            }
+            // The rows coincide only when relaxing the vertex's own row, which changes nothing
+            ROUTER_KERNEL_IVDEP
+            for (size_t vertex_to = 0; vertex_to < vertex_count; ++vertex_to)
             {
-                route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
+                const Weight candidate_weight = weight_from + weights_through[vertex_to];
+                const bool shorter = candidate_weight < weights_from[vertex_to];
+                weights_from[vertex_to] = shorter ? candidate_weight : weights_from[vertex_to];
+                prev_edges_from[vertex_to] = shorter ? prev_edges_through[vertex_to] : prev_edges_from[vertex_to];
             }
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through)
+        // Fills the row of a source vertex, weights and prev_edges are scratch arrays of vertex_count cells.
+        void BuildSourceRow(VertexId from, std::vector<Weight>& weights, std::vector<std::uint32_t>& prev_edges)
         {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through])
+            using QueueItem = std::pair<Weight, VertexId>;
+            std::fill(weights.begin(), weights.end(), INFINITE_WEIGHT);
+            std::fill(prev_edges.begin(), prev_edges.end(), NO_EDGE);
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+            weights[from] = ZERO_WEIGHT;
+            queue.push({ ZERO_WEIGHT, from });
+            while (!queue.empty())
+            {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (weight > weights[vertex])
                 {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to])
-                        {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                        }
+                    continue;
+                }
+                for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex))
+                {
+                    const auto& edge = graph_.GetEdge(edge_id);
+                    const Weight candidate_weight = weight + edge.weight;
+                    if (candidate_weight < weights[edge.to])
+                    {
+                        weights[edge.to] = candidate_weight;
+                        prev_edges[edge.to] = static_cast<std::uint32_t>(edge_id);
+                        queue.push({ candidate_weight, edge.to });
                     }
                 }
             }
+
+            RouteInternalData* row = routes_internal_data_.data() + from * weights.size();
+            for (VertexId vertex = 0; vertex < weights.size(); ++vertex)
+            {
+                row[vertex] = { static_cast<float>(weights[vertex]), prev_edges[vertex] };
+            }
         }
 
+        void PackRoutesInternalData(const BuildMatrix& routes)
+        {
+            routes_internal_data_.resize(routes.weights.size());
+            for (size_t cell = 0; cell < routes.weights.size(); ++cell)
+            {
+                routes_internal_data_[cell] = { static_cast<float>(routes.weights[cell]), routes.prev_edges[cell] };
+            }
+            routes_ = routes_internal_data_.data();
+        }
+
+        // Intermediate vertices relaxed per pass over the table and rows per task of the pool.
+        static constexpr size_t THROUGH_BLOCK_SIZE = 16;
+        static constexpr size_t ROW_BLOCK_SIZE = 16;
        
         static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::infinity();
         const Graph& graph_;
+        size_t source_count_ = graph_.GetVertexCount();
         RoutesInternalData routes_internal_data_;
+        const RouteInternalData* routes_ = nullptr;
     };
 
     template <typename Weight>
     Router<Weight>::Router(const Graph& graph)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
     {       
-        InitializeRoutesInternalData(graph);
         const size_t vertex_count = graph.GetVertexCount();
+        BuildMatrix routes(vertex_count);
+        InitializeRoutesInternalData(graph, routes);
         for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) 
         {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+            const size_t row_through = vertex_through * vertex_count;
+            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from)
+            {
+                const size_t row_from = vertex_from * vertex_count;
+                RelaxRowThroughVertex(routes.weights.data() + row_from, routes.prev_edges.data() + row_from
+                    , routes.weights.data() + row_through, routes.prev_edges.data() + row_through
+                    , vertex_count, vertex_through);
+            }
+        }
+        PackRoutesInternalData(routes);
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, thread_pool::ThreadPool& pool)
+        : graph_(graph)
+    {
+        const size_t vertex_count = graph.GetVertexCount();
+        BuildMatrix routes(vertex_count);
+        InitializeRoutesInternalData(graph, routes);
+
+        // Rows of the block vertices as they are when the serial loop relaxes through them:
+        // a relaxation through a vertex does not change its own row, so relaxing every row
+        // through the whole block with these copies repeats the serial loop exactly.
+        std::vector<Weight> through_weights(THROUGH_BLOCK_SIZE * vertex_count);
+        std::vector<std::uint32_t> through_prev_edges(THROUGH_BLOCK_SIZE * vertex_count);
+        const size_t row_block_count = (vertex_count + ROW_BLOCK_SIZE - 1) / ROW_BLOCK_SIZE;
+        for (VertexId through_begin = 0; through_begin < vertex_count; through_begin += THROUGH_BLOCK_SIZE)
+        {
+            const size_t through_end = std::min(vertex_count, through_begin + THROUGH_BLOCK_SIZE);
+            for (VertexId vertex_through = through_begin; vertex_through < through_end; ++vertex_through)
+            {
+                const size_t row = (vertex_through - through_begin) * vertex_count;
+                std::copy_n(routes.weights.data() + vertex_through * vertex_count, vertex_count, through_weights.data() + row);
+                std::copy_n(routes.prev_edges.data() + vertex_through * vertex_count, vertex_count, through_prev_edges.data() + row);
+                for (VertexId vertex_prev = through_begin; vertex_prev < vertex_through; ++vertex_prev)
+                {
+                    const size_t row_prev = (vertex_prev - through_begin) * vertex_count;
+                    RelaxRowThroughVertex(through_weights.data() + row, through_prev_edges.data() + row
+                        , through_weights.data() + row_prev, through_prev_edges.data() + row_prev
+                        , vertex_count, vertex_prev);
+                }
+            }
+
+            pool.ParallelFor(row_block_count, [&](size_t row_block)
+                {
+                    const size_t row_end = std::min(vertex_count, (row_block + 1) * ROW_BLOCK_SIZE);
+                    for (VertexId vertex_from = row_block * ROW_BLOCK_SIZE; vertex_from < row_end; ++vertex_from)
+                    {
+                        const size_t row_from = vertex_from * vertex_count;
+                        for (VertexId vertex_through = through_begin; vertex_through < through_end; ++vertex_through)
+                        {
+                            const size_t row_through = (vertex_through - through_begin) * vertex_count;
+                            RelaxRowThroughVertex(routes.weights.data() + row_from, routes.prev_edges.data() + row_from
+                                , through_weights.data() + row_through, through_prev_edges.data() + row_through
+                                , vertex_count, vertex_through);
+                        }
+                    }
+                });
+        }
+        PackRoutesInternalData(routes);
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, size_t source_count, thread_pool::ThreadPool& pool)
+        : graph_(graph)
+        , source_count_(source_count)
+    {
+        const size_t vertex_count = graph.GetVertexCount();
+        if (source_count_ > vertex_count)
+        {
+            throw std::invalid_argument("More sources than vertices in the graph");
+        }
+        if (graph.GetEdgeCount() > NO_EDGE)
+        {
+            throw std::length_error("Too many edges for the route table");
+        }
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id)
+        {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT)
+            {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        routes_internal_data_.resize(source_count_ * vertex_count);
+
+        const size_t row_block_count = (source_count_ + ROW_BLOCK_SIZE - 1) / ROW_BLOCK_SIZE;
+        pool.ParallelFor(row_block_count, [&](size_t row_block)
+            {
+                std::vector<Weight> weights(vertex_count);
+                std::vector<std::uint32_t> prev_edges(vertex_count);
+                const size_t row_end = std::min(source_count_, (row_block + 1) * ROW_BLOCK_SIZE);
+                for (VertexId vertex_from = row_block * ROW_BLOCK_SIZE; vertex_from < row_end; ++vertex_from)
+                {
+                    BuildSourceRow(vertex_from, weights, prev_edges);
+                }
+            });
+        routes_ = routes_internal_data_.data();
+    }
+
+    template<typename Weight>
+    inline graph::Router<Weight>::Router(const Graph& graph, RoutesInternalData&& data, size_t source_count)
+        : graph_(graph)
+        , source_count_(source_count)
+        , routes_internal_data_(std::move(data))
+    {
+        const size_t vertex_count = graph.GetVertexCount();
+        if (source_count_ > vertex_count || routes_internal_data_.size() != source_count_ * vertex_count)
+        {
+            throw std::invalid_argument("Route table does not match the graph");
         }
+        routes_ = routes_internal_data_.data();
     }
 
     template<typename Weight>
-    inline graph::Router<Weight>::Router(const Graph& graph, RoutesInternalData&& data) : graph_(graph)
+    inline graph::Router<Weight>::Router(const Graph& graph, const RouteInternalData* routes, size_t route_count
+        , size_t source_count)
+        : graph_(graph)
+        , source_count_(source_count)
+        , routes_(routes)
     {
-        routes_internal_data_ = { data.begin(), data.end() };
+        const size_t vertex_count = graph.GetVertexCount();
+        if (source_count_ > vertex_count || route_count != source_count_ * vertex_count)
+        {
+            throw std::invalid_argument("Route table does not match the graph");
+        }
     }
 
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const
     {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data)
+        std::vector<EdgeId> edges;
+        const std::optional<Weight> weight = BuildRoute(from, to, edges);
+        if (!weight)
         {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
-        std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+        return RouteInfo{ *weight, std::move(edges) };
+    }
+
+    template <typename Weight>
+    std::optional<Weight> Router<Weight>::BuildRoute(VertexId from, VertexId to, std::vector<EdgeId>& edges) const
+    {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= source_count_ || to >= vertex_count)
+        {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        edges.clear();
+        const RouteInternalData* row_from = routes_ + from * vertex_count;
+        if (row_from[to].weight == UNREACHABLE)
         {
-            edges.push_back(*edge_id);
+            return std::nullopt;
+        }
+        // The table keeps a rounded weight, the exact one is summed along the route.
+        // A table read from a base file may be broken: a prev edge out of the graph or
+        // a route longer than the vertex count means it does not match the graph.
+        Weight weight = ZERO_WEIGHT;
+        const size_t edge_count = graph_.GetEdgeCount();
+        for (std::uint32_t edge_id = row_from[to].prev_edge;
+            edge_id != NO_EDGE;
+            edge_id = row_from[graph_.GetEdgeUnchecked(edge_id).from].prev_edge)
+        {
+            if (edge_id >= edge_count || edges.size() == vertex_count)
+            {
+                throw std::invalid_argument("Route table does not match the graph");
+            }
+            edges.push_back(edge_id);
+            weight += graph_.GetEdgeUnchecked(edge_id).weight;
         }
         std::reverse(edges.begin(), edges.end());
-
-        return RouteInfo{ weight, std::move(edges) };
+        return weight;
     }
 
 }  // namespace graph
\ No newline at end of file
@@ -1,11 +1,87 @@
 #include "serialization.h"
 
+#ifdef TRANSPORT_CATALOGUE_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+    transport_catalogue_proto::RenderedMap PackRenderedMap(const std::string& svg, domain::MapStorage storage)
+    {
+        transport_catalogue_proto::RenderedMap map;
+        map.set_size(svg.size());
+        if (storage != domain::MapStorage::COMPRESSED)
+        {
+            map.set_svg(svg);
+            return map;
+        }
+#ifdef TRANSPORT_CATALOGUE_WITH_ZLIB
+        uLongf compressed_size = compressBound(static_cast<uLong>(svg.size()));
+        std::string compressed(compressed_size, '\0');
+        if (compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressed_size
+            , reinterpret_cast<const Bytef*>(svg.data()), static_cast<uLong>(svg.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            throw std::runtime_error("Failed to compress the map");
+        }
+        compressed.resize(compressed_size);
+        map.set_svg(std::move(compressed));
+        map.set_compression(transport_catalogue_proto::ZLIB);
+        return map;
+#else
+        throw std::runtime_error("The program is built without zlib, the map cannot be compressed");
+#endif
+    }
+
+    std::string UnpackRenderedMap(const transport_catalogue_proto::RenderedMap& map)
+    {
+        if (map.compression() == transport_catalogue_proto::UNCOMPRESSED)
+        {
+            return map.svg();
+        }
+#ifdef TRANSPORT_CATALOGUE_WITH_ZLIB
+        std::string svg(map.size(), '\0');
+        uLongf size = static_cast<uLongf>(svg.size());
+        if (uncompress(reinterpret_cast<Bytef*>(svg.data()), &size
+            , reinterpret_cast<const Bytef*>(map.svg().data()), static_cast<uLong>(map.svg().size())) != Z_OK
+            || size != svg.size())
+        {
+            throw std::runtime_error("Base file has a broken map");
+        }
+        return svg;
+#else
+        throw std::runtime_error("The program is built without zlib, the map cannot be decompressed");
+#endif
+    }
+
+    // Indices read from the mapped base refer to other sections, a broken file must not send them past the end.
+    void CheckIndex(size_t index, size_t size)
+    {
+        if (index >= size)
+        {
+            throw std::runtime_error("Base file is corrupted");
+        }
+    }
+
+    void CheckRange(size_t begin, size_t end, size_t size)
+    {
+        if (begin > end || end > size)
+        {
+            throw std::runtime_error("Base file is corrupted");
+        }
+    }
+}
+
 namespace serialization
 {
 
     Serialization::Serialization(const request::RequestReader& rr, const transport_catalogue::TransportCatalogue& tc)
         : rr_(rr), tc_(tc)
     {
+        if (rr_.GetBaseFormat() == domain::BaseFormat::MAPPED)
+        {
+            SaveMappedBase(rr.GetRoutingSettings());
+            return;
+        }
         std::ofstream out(rr_.GetPath(), std::ios::binary);
         if (out.is_open())
         {
@@ -13,7 +89,12 @@ namespace serialization
             AddProtoBus(tc_proto, tc_.GetRoute());
             AddProtoStop(tc_proto, tc_.GetStop());
             AddProtoDistanceFromTo(tc_proto, tc_.GetMapDistance());
+            AddProtoStopBuses(tc_proto);
             SaveMap(tc_proto, rr.GetRendereSettings());
+            if (rr_.GetMapStorage() != domain::MapStorage::NONE)
+            {
+                *tc_proto.mutable_rendered_map() = RenderMap();
+            }
             GreateProtoTransportRouter(tc_proto, tc_, rr.GetRoutingSettings());
 
             tc_proto.SerializePartialToOstream(&out);
@@ -21,7 +102,7 @@ namespace serialization
     }
 
     void Serialization::AddProtoBus(transport_catalogue_proto::TransportCatalogue& tc_proto
-        , const std::deque<transport_catalogue::Bus>& buses)
+        , transport_catalogue::TransportCatalogue::BusesRange buses)
     {
         for (const auto& bus : buses)
         {
@@ -33,13 +114,18 @@ namespace serialization
             {
                 b.add_stops(stop->name);
             }
+            const transport_catalogue::BusStat& stat = tc_.GetBusStat(bus.id);
+            b.mutable_stat()->set_total_stops(stat.total_stops);
+            b.mutable_stat()->set_unique_stops(stat.unique_stops);
+            b.mutable_stat()->set_route_length(stat.route_length);
+            b.mutable_stat()->set_distance(stat.distance);
 
             tc_proto.mutable_buses()->Add(std::move(b));
         }
     }
 
     void Serialization::AddProtoStop(transport_catalogue_proto::TransportCatalogue& tc_proto
-        , const std::deque<transport_catalogue::Stop>& stops)
+        , transport_catalogue::TransportCatalogue::StopsRange stops)
     {
         for (const auto& stop : stops)
         {
@@ -57,13 +143,21 @@ namespace serialization
         for (const auto& [stops, dis] : distances)
         {
             transport_catalogue_proto::DistanceFromTo dist;
-            dist.set_from_stop(stops.first->name);
-            dist.set_to_stop(stops.second->name);
+            dist.set_from_stop(tc_.GetStopById(stops.first).name);
+            dist.set_to_stop(tc_.GetStopById(stops.second).name);
             dist.set_distance(dis);
             tc_proto.mutable_distance()->Add(std::move(dist));
         }
     }
 
+    void Serialization::AddProtoStopBuses(transport_catalogue_proto::TransportCatalogue& tc_proto)
+    {
+        const auto& offsets = tc_.GetStopBusesOffsets();
+        const auto& buses = tc_.GetStopBuses();
+        tc_proto.mutable_stop_buses_offsets()->Add(offsets.begin(), offsets.end());
+        tc_proto.mutable_stop_buses()->Add(buses.begin(), buses.end());
+    }
+
     transport_catalogue_proto::Color Serialization::SaveColor(const svg::Color& color)
     {
         transport_catalogue_proto::Color col;
@@ -118,6 +212,12 @@ namespace serialization
         tc_proto.mutable_map()->Swap(&map);
     }
 
+    transport_catalogue_proto::RenderedMap Serialization::RenderMap() const
+    {
+        const renderer::MapRenderer renderer(rr_.GetRendereSettings(), tc_, rr_.GetThreadCount());
+        return PackRenderedMap(renderer.GetMap(), rr_.GetMapStorage());
+    }
+
     void Serialization::AddProtoRouterGraphEdges(transport_catalogue_proto::TransportRouter& router
         , std::vector<graph::Edge<double>> edges)
     {
@@ -172,7 +272,7 @@ namespace serialization
         transport_catalogue_proto::EdgeInfo var;
         if (std::holds_alternative<transport_router::TransportRouter::BusEdgeInfo>(edge_info))
         {
-            var.mutable_bus_edge_info()->set_name_bus(std::get<transport_router::TransportRouter::BusEdgeInfo>(edge_info).bus_name);
+            var.mutable_bus_edge_info()->set_name_bus(std::string(std::get<transport_router::TransportRouter::BusEdgeInfo>(edge_info).bus_name));
             var.mutable_bus_edge_info()->set_span_count(std::get<transport_router::TransportRouter::BusEdgeInfo>(edge_info).span_count);
             var.mutable_bus_edge_info()->set_number_edge(std::get<transport_router::TransportRouter::BusEdgeInfo>(edge_info).number_edge);
         }
@@ -197,50 +297,56 @@ namespace serialization
     {
         router.mutable_routing_settings()->set_bus_wait_time(routing_settings.bus_wait_time);
         router.mutable_routing_settings()->set_bus_velocity(routing_settings.bus_velocity);
+        router.mutable_routing_settings()->set_router_mode(
+            static_cast<transport_catalogue_proto::RouterMode>(routing_settings.router_mode));
+        router.mutable_routing_settings()->set_graph_model(
+            static_cast<transport_catalogue_proto::GraphModel>(routing_settings.graph_model));
+        router.mutable_routing_settings()->set_route_cache_size(static_cast<std::uint32_t>(routing_settings.route_cache_size));
     }
 
-    transport_catalogue_proto::RouterInternalData Serialization::AddProtoRouterInternalData
-    (const std::optional<transport_router::TransportRouter::Router::RouteInternalData>& one_data)
+    void Serialization::AddProtoRouterData(transport_catalogue_proto::TransportRouter& router
+        , const RoutesInternalData& all_data)
     {
-        transport_catalogue_proto::RouterInternalData data_proto;
-        if (one_data.has_value())
-        {
-            data_proto.set_flag(true);
-            data_proto.set_weigth(one_data.value().weight);
-            if (one_data.value().prev_edge.has_value())
-            {
-                data_proto.mutable_prev()->set_prev_dge(one_data.value().prev_edge.value());
-                data_proto.mutable_prev()->set_flag(true);
-            }
-        }
-        return data_proto;
+        router.mutable_graph_router()->set_router_data(reinterpret_cast<const char*>(all_data.begin())
+            , (all_data.end() - all_data.begin()) * sizeof(graph::Router<double>::RouteInternalData));
     }
 
-    transport_catalogue_proto::VectorRouterInternalData Serialization::AddProtoRouterVectorRouterInternalData
-    (const std::vector<std::optional<graph::Router<double>::RouteInternalData>>& data)
+    void Serialization::AddProtoHierarchySearchGraph(transport_catalogue_proto::HierarchySearchGraph& graph_proto
+        , const transport_router::TransportRouter::Hierarchy::SearchGraph& search_graph)
     {
-        transport_catalogue_proto::VectorRouterInternalData v_data;
-        for (const auto& one_data : data)
-        {
-            v_data.mutable_data()->Add(std::move(AddProtoRouterInternalData(one_data)));
-        }
-        return v_data;
+        graph_proto.mutable_offsets()->Add(search_graph.offsets.begin(), search_graph.offsets.end());
+        graph_proto.mutable_edges()->Add(search_graph.edges.begin(), search_graph.edges.end());
     }
 
-    void Serialization::AddProtoRouterData(transport_catalogue_proto::TransportRouter& router
-        , const RoutesInternalData& all_data)
+    void Serialization::AddProtoRouterHierarchy(transport_catalogue_proto::TransportRouter& router
+        , const transport_router::TransportRouter::Hierarchy& hierarchy)
     {
-        for (const auto& data : all_data)
+        using Hierarchy = transport_router::TransportRouter::Hierarchy;
+        transport_catalogue_proto::ContractionHierarchy hierarchy_proto;
+        for (const auto& edge : hierarchy.GetEdges())
         {
-            router.mutable_graph_router()->mutable_router_data()->Add(std::move(AddProtoRouterVectorRouterInternalData(data)));
+            transport_catalogue_proto::HierarchyEdge edge_proto;
+            edge_proto.set_from(edge.from);
+            edge_proto.set_to(edge.to);
+            edge_proto.set_weight(edge.weight);
+            edge_proto.set_first(edge.first);
+            if (edge.second != Hierarchy::NO_EDGE)
+            {
+                edge_proto.set_second(edge.second);
+                edge_proto.set_is_shortcut(true);
+            }
+            hierarchy_proto.mutable_edges()->Add(std::move(edge_proto));
         }
+        AddProtoHierarchySearchGraph(*hierarchy_proto.mutable_upward(), hierarchy.GetUpwardGraph());
+        AddProtoHierarchySearchGraph(*hierarchy_proto.mutable_downward(), hierarchy.GetDownwardGraph());
+        router.mutable_hierarchy()->Swap(&hierarchy_proto);
     }
 
     void Serialization::GreateProtoTransportRouter(transport_catalogue_proto::TransportCatalogue& tc_proto
         , const transport_catalogue::TransportCatalogue& db, const domain::RoutingSettings& routing_settings)
     {
         transport_catalogue_proto::TransportRouter router;
-        transport_router::TransportRouter tr(db, routing_settings);
+        transport_router::TransportRouter tr(db, routing_settings, rr_.GetThreadCount());
 
         AddProtoRouterGraphEdges(router, tr.GetGraph().GetEdges());
         AddProtoRouterGraphIncidenceLists(router, tr.GetGraph().GetIncidenceLists());
@@ -248,9 +354,137 @@ namespace serialization
         AddProtoRouterVertexInfo(router, tr.GetVertexInfo());
         AddProtoRouterEdgesInfo(router, tr.GetVectorEdgeInfo());
         AddProtoRouterRoutingSettings(router, routing_settings);
-        AddProtoRouterData(router, tr.GetRouter().GetRouterData());
+        if (const auto* all_pairs_router = tr.GetRouter())
+        {
+            AddProtoRouterData(router, all_pairs_router->GetRouterData());
+        }
+        if (const auto* hierarchy = tr.GetHierarchy())
+        {
+            AddProtoRouterHierarchy(router, *hierarchy);
+        }
         tc_proto.mutable_router()->Swap(&router);
     }
+
+    void Serialization::SaveMappedBase(const domain::RoutingSettings& routing_settings)
+    {
+        using namespace mapped_base;
+        Writer writer;
+
+        // Records are stored in id order, so an index in STOPS or BUSES is the id in the catalogue.
+        std::vector<StopRecord> stop_records;
+        stop_records.reserve(tc_.GetStopCount());
+        for (const auto& stop : tc_.GetStop())
+        {
+            stop_records.push_back({ writer.AddString(stop.name), stop.coordinates.lat, stop.coordinates.lng });
+        }
+        writer.SetSection(Section::STOPS, stop_records);
+
+        std::vector<BusRecord> bus_records;
+        bus_records.reserve(tc_.GetBusCount());
+        std::vector<std::uint32_t> bus_stops;
+        for (const auto& bus : tc_.GetRoute())
+        {
+            BusRecord record{ writer.AddString(bus.name), writer.AddString(bus.name_last_stop)
+                , static_cast<std::uint32_t>(bus_stops.size()), 0, bus.is_roundtrip, 0 };
+            for (const auto& stop : bus.stops)
+            {
+                bus_stops.push_back(stop->id);
+            }
+            record.stops_end = static_cast<std::uint32_t>(bus_stops.size());
+            bus_records.push_back(record);
+        }
+        writer.SetSection(Section::BUSES, bus_records);
+        writer.SetSection(Section::BUS_STOPS, bus_stops);
+
+        std::vector<BusStatRecord> bus_stats;
+        bus_stats.reserve(tc_.GetBusCount());
+        for (const auto& bus : tc_.GetRoute())
+        {
+            const transport_catalogue::BusStat& stat = tc_.GetBusStat(bus.id);
+            bus_stats.push_back({ stat.total_stops, stat.unique_stops, stat.route_length, stat.distance, 0 });
+        }
+        writer.SetSection(Section::BUS_STATS, bus_stats);
+        writer.SetSection(Section::STOP_BUSES_OFFSETS, tc_.GetStopBusesOffsets());
+        writer.SetSection(Section::STOP_BUSES, tc_.GetStopBuses());
+
+        std::vector<DistanceRecord> distances;
+        for (const auto& [stops_pair, distance] : tc_.GetMapDistance())
+        {
+            distances.push_back({ stops_pair.first, stops_pair.second, distance });
+        }
+        writer.SetSection(Section::DISTANCES, distances);
+
+        transport_catalogue_proto::TransportCatalogue tc_proto;
+        SaveMap(tc_proto, rr_.GetRendereSettings());
+        const std::string map = tc_proto.map().SerializeAsString();
+        writer.SetSection(Section::RENDER_SETTINGS, map.data(), map.size());
+        if (rr_.GetMapStorage() != domain::MapStorage::NONE)
+        {
+            const std::string rendered_map = RenderMap().SerializeAsString();
+            writer.SetSection(Section::RENDERED_MAP, rendered_map.data(), rendered_map.size());
+        }
+
+        const RoutingRecord routing{ routing_settings.bus_wait_time
+            , static_cast<std::uint32_t>(routing_settings.router_mode), routing_settings.bus_velocity
+            , static_cast<std::uint32_t>(routing_settings.graph_model)
+            , static_cast<std::uint32_t>(routing_settings.route_cache_size) };
+        writer.SetSection(Section::ROUTING_SETTINGS, &routing, 1);
+
+        const transport_router::TransportRouter tr(tc_, routing_settings, rr_.GetThreadCount());
+        AddMappedRouter(writer, tr);
+
+        writer.Save(rr_.GetPath());
+    }
+
+    void Serialization::AddMappedRouter(mapped_base::Writer& writer, const transport_router::TransportRouter& tr)
+    {
+        using namespace mapped_base;
+        using TransportRouter = transport_router::TransportRouter;
+
+        std::vector<std::uint32_t> vertices;
+        for (const auto& stop : tr.GetVertexInfo())
+        {
+            vertices.push_back(*tc_.FindStopId(stop));
+        }
+        writer.SetSection(Section::VERTICES, vertices);
+
+        std::vector<StopVertexRecord> stop_vertices;
+        for (const auto& [stop, vertex] : tr.GetStopVertexId())
+        {
+            stop_vertices.push_back({ *tc_.FindStopId(stop), static_cast<std::uint32_t>(vertex) });
+        }
+        writer.SetSection(Section::STOP_VERTICES, stop_vertices);
+
+        writer.SetSection(Section::EDGES, tr.GetGraph().GetEdges());
+
+        std::vector<EdgeInfoRecord> edges_info;
+        for (const auto& edge_info : tr.GetVectorEdgeInfo())
+        {
+            if (const auto* bus_info = std::get_if<TransportRouter::BusEdgeInfo>(&edge_info))
+            {
+                edges_info.push_back({ *tc_.FindBusId(bus_info->bus_name), static_cast<std::uint32_t>(bus_info->span_count) });
+            }
+            else
+            {
+                edges_info.push_back({ NO_INDEX, 0 });
+            }
+        }
+        writer.SetSection(Section::EDGES_INFO, edges_info);
+
+        if (const auto* all_pairs_router = tr.GetRouter())
+        {
+            const auto routes = all_pairs_router->GetRouterData();
+            writer.SetSection(Section::ROUTES, routes.begin(), routes.end() - routes.begin());
+        }
+        if (const auto* hierarchy = tr.GetHierarchy())
+        {
+            writer.SetSection(Section::HIERARCHY_EDGES, hierarchy->GetEdges());
+            writer.SetSection(Section::HIERARCHY_UPWARD_OFFSETS, hierarchy->GetUpwardGraph().offsets);
+            writer.SetSection(Section::HIERARCHY_UPWARD_EDGES, hierarchy->GetUpwardGraph().edges);
+            writer.SetSection(Section::HIERARCHY_DOWNWARD_OFFSETS, hierarchy->GetDownwardGraph().offsets);
+            writer.SetSection(Section::HIERARCHY_DOWNWARD_EDGES, hierarchy->GetDownwardGraph().edges);
+        }
+    }
 }// ---------------------------------end namespace serialization
 
 namespace deserialization 
@@ -268,14 +502,31 @@ namespace deserialization
 
     Deserialization::Deserialization(const request::RequestReader& rr) : rr_(rr)
     {
+        if (rr_.GetBaseFormat() == domain::BaseFormat::MAPPED)
+        {
+            LoadMappedBase();
+            return;
+        }
         std::ifstream in(rr_.GetPath(), std::ios::binary);
         transport_catalogue_proto::TransportCatalogue tc_proto;
         if (tc_proto.ParseFromIstream(&in))
         {
             CreateTransportCatalogue(CreateBuses(tc_proto), CreateStops(tc_proto)
                 , CreateMapDistanceBetwinStops(tc_proto));
+            LoadBusStats(tc_proto);
+            LoadStopBuses(tc_proto);
             CreateRenderSettings(tc_proto.map());
-            renderer_(settings_, tc_);
+            if (tc_proto.has_rendered_map())
+            {
+                renderer_.SetMapLoader([map = std::move(*tc_proto.mutable_rendered_map())]
+                    {
+                        return UnpackRenderedMap(map);
+                    });
+            }
+            else
+            {
+                renderer_(settings_, tc_, rr_.GetThreadCount());
+            }
             CreateTransportRouter(tc_proto.router());
         }
     }
@@ -334,9 +585,9 @@ namespace deserialization
         }
         for (const auto& [stops, dist] : dist_betw_stops)
         {
-            transport_catalogue::StopPtr stop1 = tc_.FindStop(stops.first);
-            transport_catalogue::StopPtr stop2 = tc_.FindStop(stops.second);
-            tc_.CreateDistBetweenStops(stop1, stop2, dist);
+            const auto stop1 = tc_.FindStopId(stops.first);
+            const auto stop2 = tc_.FindStopId(stops.second);
+            tc_.CreateDistBetweenStops(stop1.value(), stop2.value(), dist);
         }
         for (auto bus : buses)
         {
@@ -345,6 +596,38 @@ namespace deserialization
         }
     }
 
+    void Deserialization::LoadBusStats(const transport_catalogue_proto::TransportCatalogue& tc_proto)
+    {
+        transport_catalogue::BusId id = 0;
+        for (const auto& bus : tc_proto.buses())
+        {
+            if (!bus.has_stat())
+            {
+                // Base written before statistics were stored.
+                tc_.ComputeBusStats();
+                return;
+            }
+            transport_catalogue::BusStat stat;
+            stat.total_stops = bus.stat().total_stops();
+            stat.unique_stops = bus.stat().unique_stops();
+            stat.route_length = bus.stat().route_length();
+            stat.distance = static_cast<int>(bus.stat().distance());
+            tc_.SetBusStat(id++, stat);
+        }
+    }
+
+    void Deserialization::LoadStopBuses(const transport_catalogue_proto::TransportCatalogue& tc_proto)
+    {
+        if (tc_proto.stop_buses_offsets().empty())
+        {
+            // Base written before stop buses were stored.
+            tc_.ComputeStopBuses();
+            return;
+        }
+        tc_.SetStopBuses({ tc_proto.stop_buses_offsets().begin(), tc_proto.stop_buses_offsets().end() }
+            , { tc_proto.stop_buses().begin(), tc_proto.stop_buses().end() });
+    }
+
     svg::Color Deserialization::LoadColor(const transport_catalogue_proto::Color& color)
     {
         svg::Color result;
@@ -400,6 +683,7 @@ namespace deserialization
     (const transport_catalogue_proto::TransportRouter& router)
     {
         std::vector<graph::Edge<double>> edges;
+        edges.reserve(router.graph().edges_size());
         {
             for (const auto& edge : router.graph().edges())
             {
@@ -409,19 +693,6 @@ namespace deserialization
         return edges;
     }
 
-    std::vector<std::vector<graph::EdgeId>> Deserialization::AddInclidenceLists
-    (const transport_catalogue_proto::TransportRouter& router)
-    {
-        std::vector<std::vector<graph::EdgeId>> incidence_lsts;
-        {
-            for (const auto& lists : router.graph().inclidence_lists())
-            {
-                incidence_lsts.push_back({ lists.edge_id().begin(), lists.edge_id().end() });
-            }
-        }
-        return incidence_lsts;
-    }
-
     std::unordered_map<Deserialization::StopName, graph::VertexId> Deserialization::AddStopsVertexId
     (const transport_catalogue_proto::TransportRouter& router)
     {
@@ -449,8 +720,14 @@ namespace deserialization
         {
             if (edge.has_bus_edge_info())
             {
+                // The name is kept by the catalogue, the message is gone once the router is built
+                const auto bus = tc_.FindBusId(edge.bus_edge_info().name_bus());
+                if (!bus)
+                {
+                    throw std::runtime_error("Base file is corrupted");
+                }
                 transport_router::TransportRouter::BusEdgeInfo bus_info;
-                bus_info.bus_name = edge.bus_edge_info().name_bus();
+                bus_info.bus_name = tc_.GetBusById(*bus).name;
                 bus_info.span_count = edge.bus_edge_info().span_count();
                 bus_info.number_edge = edge.bus_edge_info().number_edge();
                 edges_info.push_back(std::move(bus_info));
@@ -463,43 +740,43 @@ namespace deserialization
         return edges_info;
     }
 
-    std::vector<std::optional<graph::Router<double>::RouteInternalData>> Deserialization::AddRouteInternalData
-    (const transport_catalogue_proto::VectorRouterInternalData& data_proto)
+    graph::Router<double>::RoutesInternalData Deserialization::AddRoutersInternalData
+    (const transport_catalogue_proto::TransportRouter& router)
     {
-        std::vector<std::optional<graph::Router<double>::RouteInternalData>> result;
-        for (const auto& all_data : data_proto.data())
+        using RouteInternalData = graph::Router<double>::RouteInternalData;
+        const std::string& bytes = router.graph_router().router_data();
+        if (bytes.size() % sizeof(RouteInternalData) != 0)
         {
-            if (all_data.flag())
-            {
-                graph::Router<double>::RouteInternalData one_data;
-                one_data.weight = all_data.weigth();
-                if (all_data.prev().flag())
-                {
-                    one_data.prev_edge = all_data.prev().prev_dge();
-                }
-                else
-                {
-                    one_data.prev_edge = std::nullopt;
-                }
-                result.push_back(std::move(one_data));
-            }
-            else
-            {
-                result.push_back(std::nullopt);
-            }
+            throw std::invalid_argument("Route table is corrupted");
         }
-        return result;
+        graph::Router<double>::RoutesInternalData data(bytes.size() / sizeof(RouteInternalData));
+        std::memcpy(data.data(), bytes.data(), bytes.size());
+        return data;
     }
 
-    graph::Router<double>::RoutesInternalData Deserialization::AddRoutersInternalData
+    transport_router::TransportRouter::Hierarchy::SearchGraph Deserialization::AddHierarchySearchGraph
+    (const transport_catalogue_proto::HierarchySearchGraph& graph_proto)
+    {
+        transport_router::TransportRouter::Hierarchy::SearchGraph search_graph;
+        search_graph.offsets = { graph_proto.offsets().begin(), graph_proto.offsets().end() };
+        search_graph.edges = { graph_proto.edges().begin(), graph_proto.edges().end() };
+        return search_graph;
+    }
+
+    transport_router::TransportRouter::HierarchyData Deserialization::AddHierarchy
     (const transport_catalogue_proto::TransportRouter& router)
     {
-        graph::Router<double>::RoutesInternalData data;
-        for (const auto& data_proto : router.graph_router().router_data())
+        using Hierarchy = transport_router::TransportRouter::Hierarchy;
+        transport_router::TransportRouter::HierarchyData hierarchy;
+        hierarchy.edges.reserve(router.hierarchy().edges_size());
+        for (const auto& edge : router.hierarchy().edges())
         {
-            data.push_back(std::move(AddRouteInternalData(data_proto)));
+            hierarchy.edges.push_back({ edge.from(), edge.to(), edge.weight(), edge.first()
+                , edge.is_shortcut() ? edge.second() : Hierarchy::NO_EDGE });
         }
-        return data;
+        hierarchy.upward = AddHierarchySearchGraph(router.hierarchy().upward());
+        hierarchy.downward = AddHierarchySearchGraph(router.hierarchy().downward());
+        return hierarchy;
     }
 
     domain::RoutingSettings Deserialization::AddRoutinSettings
@@ -508,6 +785,9 @@ namespace deserialization
         domain::RoutingSettings settings;
         settings.bus_wait_time = router.routing_settings().bus_wait_time();
         settings.bus_velocity = router.routing_settings().bus_velocity();
+        settings.router_mode = static_cast<domain::RouterMode>(router.routing_settings().router_mode());
+        settings.graph_model = static_cast<domain::GraphModel>(router.routing_settings().graph_model());
+        settings.route_cache_size = router.routing_settings().route_cache_size();
         return settings;
     }
 
@@ -518,15 +798,248 @@ namespace deserialization
             , std::move(AddStopsVertexId(router_proto))
             , std::move(AddVertexInfo(router_proto))
             , std::move(AddEdgesInfo(router_proto))
-            , std::move(AddEdges(router_proto))
-            , std::move(AddInclidenceLists(router_proto))
-            , std::move(AddRoutersInternalData(router_proto)));
+            , transport_router::TransportRouter::BusGraph(router_proto.graph().inclidence_lists_size()
+                , AddEdges(router_proto))
+            , transport_router::TransportRouter::RouterData{ AddRoutersInternalData(router_proto), nullptr, 0
+                , AddHierarchy(router_proto) });
     }
 
-    void Deserialization::PrintStatRequest() const noexcept
+    void Deserialization::LoadMappedBase()
+    {
+        mapped_base_ = std::make_unique<mapped_base::Reader>(rr_.GetPath());
+        LoadMappedCatalogue(*mapped_base_);
+
+        const auto map = mapped_base_->GetSection<char>(mapped_base::Section::RENDER_SETTINGS);
+        transport_catalogue_proto::Map map_proto;
+        if (!map_proto.ParseFromArray(map.begin(), static_cast<int>(map.end() - map.begin())))
+        {
+            throw std::runtime_error("Base file has broken render settings");
+        }
+        CreateRenderSettings(map_proto);
+        const auto rendered_map = mapped_base_->GetSection<char>(mapped_base::Section::RENDERED_MAP);
+        if (rendered_map.begin() != rendered_map.end())
+        {
+            // The section stays mapped as long as the base, it is parsed on the first Map request
+            renderer_.SetMapLoader([rendered_map]
+                {
+                    transport_catalogue_proto::RenderedMap map;
+                    if (!map.ParseFromArray(rendered_map.begin(), static_cast<int>(rendered_map.end() - rendered_map.begin())))
+                    {
+                        throw std::runtime_error("Base file has a broken map");
+                    }
+                    return UnpackRenderedMap(map);
+                });
+        }
+        else
+        {
+            renderer_(settings_, tc_, rr_.GetThreadCount());
+        }
+
+        CreateMappedTransportRouter(*mapped_base_);
+    }
+
+    void Deserialization::LoadMappedCatalogue(const mapped_base::Reader& base)
+    {
+        using namespace mapped_base;
+
+        std::vector<Stop> stops;
+        std::vector<std::string_view> stop_names;
+        for (const auto& record : base.GetSection<StopRecord>(Section::STOPS))
+        {
+            stop_names.push_back(base.GetString(record.name));
+            Stop stop;
+            stop.name = stop_names.back();
+            stop.coordinates = { record.latitude, record.longitude };
+            stops.push_back(std::move(stop));
+        }
+
+        const auto bus_stops = base.GetSection<std::uint32_t>(Section::BUS_STOPS);
+        std::vector<Bus> buses;
+        for (const auto& record : base.GetSection<BusRecord>(Section::BUSES))
+        {
+            Bus bus;
+            bus.name = base.GetString(record.name);
+            bus.name_last_stop = base.GetString(record.name_last_stop);
+            bus.is_roundtrip = record.is_roundtrip != 0;
+            // A bus has at least one stop, AddBus takes the first of them
+            CheckRange(record.stops_begin, record.stops_end, bus_stops.end() - bus_stops.begin());
+            CheckIndex(record.stops_begin, record.stops_end);
+            for (auto it = bus_stops.begin() + record.stops_begin; it != bus_stops.begin() + record.stops_end; ++it)
+            {
+                CheckIndex(*it, stop_names.size());
+                bus.stops_for_bus.emplace_back(stop_names[*it]);
+            }
+            buses.push_back(std::move(bus));
+        }
+
+        CreateTransportCatalogue(std::move(buses), std::move(stops), {});
+
+        // Stops get their ids in the order of STOPS, so the records give the ids of the catalogue
+        for (const auto& record : base.GetSection<DistanceRecord>(Section::DISTANCES))
+        {
+            CheckIndex(record.from, stop_names.size());
+            CheckIndex(record.to, stop_names.size());
+            tc_.CreateDistBetweenStops(record.from, record.to, record.distance);
+        }
+
+        const auto bus_stats = base.GetSection<BusStatRecord>(Section::BUS_STATS);
+        if (static_cast<size_t>(bus_stats.end() - bus_stats.begin()) != tc_.GetBusCount())
+        {
+            throw std::runtime_error("Base file is corrupted");
+        }
+        transport_catalogue::BusId id = 0;
+        for (const BusStatRecord& record : bus_stats)
+        {
+            tc_.SetBusStat(id++, { record.total_stops, record.unique_stops, record.route_length, record.distance });
+        }
+        const auto stop_buses_offsets = base.GetSection<std::uint32_t>(Section::STOP_BUSES_OFFSETS);
+        const auto stop_buses = base.GetSection<transport_catalogue::BusId>(Section::STOP_BUSES);
+        for (auto it = stop_buses_offsets.begin(); it != stop_buses_offsets.end(); ++it)
+        {
+            CheckRange(it == stop_buses_offsets.begin() ? 0 : *(it - 1), *it, stop_buses.end() - stop_buses.begin());
+        }
+        for (const transport_catalogue::BusId bus : stop_buses)
+        {
+            CheckIndex(bus, tc_.GetBusCount());
+        }
+        tc_.SetStopBuses({ stop_buses_offsets.begin(), stop_buses_offsets.end() }, { stop_buses.begin(), stop_buses.end() });
+    }
+
+    void Deserialization::CreateMappedTransportRouter(const mapped_base::Reader& base)
+    {
+        using namespace mapped_base;
+        using TransportRouter = transport_router::TransportRouter;
+
+        const auto routing = base.GetSection<RoutingRecord>(Section::ROUTING_SETTINGS);
+        if (routing.begin() == routing.end())
+        {
+            throw std::runtime_error("Base file has no routing settings");
+        }
+        domain::RoutingSettings routing_settings;
+        routing_settings.bus_wait_time = routing.begin()->bus_wait_time;
+        routing_settings.bus_velocity = routing.begin()->bus_velocity;
+        routing_settings.router_mode = static_cast<domain::RouterMode>(routing.begin()->router_mode);
+        routing_settings.graph_model = static_cast<domain::GraphModel>(routing.begin()->graph_model);
+        routing_settings.route_cache_size = routing.begin()->route_cache_size;
+
+        const auto stops = base.GetSection<StopRecord>(Section::STOPS);
+        const size_t stop_count = stops.end() - stops.begin();
+        const auto stop_name = [&base, &stops, stop_count](std::uint32_t stop)
+        {
+            CheckIndex(stop, stop_count);
+            return std::string(base.GetString((stops.begin() + stop)->name));
+        };
+
+        TransportRouter::Vertices vertices_info;
+        for (const std::uint32_t stop : base.GetSection<std::uint32_t>(Section::VERTICES))
+        {
+            vertices_info.push_back(stop_name(stop));
+        }
+        TransportRouter::StopsVertexId stops_vertex_id;
+        for (const auto& record : base.GetSection<StopVertexRecord>(Section::STOP_VERTICES))
+        {
+            CheckIndex(record.vertex, vertices_info.size());
+            stops_vertex_id.insert({ stop_name(record.stop), record.vertex });
+        }
+
+        const auto buses = base.GetSection<BusRecord>(Section::BUSES);
+        const size_t bus_count = buses.end() - buses.begin();
+        const auto edges_records = base.GetSection<EdgeInfoRecord>(Section::EDGES_INFO);
+        std::vector<TransportRouter::EdgeInfo> edges_info;
+        edges_info.reserve(edges_records.end() - edges_records.begin());
+        for (const auto& record : edges_records)
+        {
+            if (record.bus == NO_INDEX)
+            {
+                edges_info.push_back(TransportRouter::WaitAdgeInfo());
+            }
+            else
+            {
+                CheckIndex(record.bus, bus_count);
+                edges_info.push_back(TransportRouter::BusEdgeInfo{ base.GetString((buses.begin() + record.bus)->name)
+                    , record.span_count, edges_info.size() });
+            }
+        }
+
+        const auto edges = base.GetSection<graph::Edge<double>>(Section::EDGES);
+        // Every vertex of the split graph has a stop in VERTICES, the complete one has a vertex per stop
+        const size_t vertex_count = routing_settings.graph_model == domain::GraphModel::SPLIT
+            ? vertices_info.size() : stop_count;
+        // Legs take the stops of the edge ends from VERTICES and the bus from EDGES_INFO
+        if (static_cast<size_t>(edges.end() - edges.begin()) != edges_info.size() || vertices_info.size() > vertex_count)
+        {
+            throw std::runtime_error("Base file is corrupted");
+        }
+        for (const auto& edge : edges)
+        {
+            CheckIndex(edge.from, vertices_info.size());
+            CheckIndex(edge.to, vertices_info.size());
+        }
+        TransportRouter::BusGraph graph(vertex_count, { edges.begin(), edges.end() });
+
+        TransportRouter::RouterData router_data;
+        const auto routes = base.GetSection<TransportRouter::Router::RouteInternalData>(Section::ROUTES);
+        if (routes.begin() != routes.end())
+        {
+            router_data.mapped_routes = routes.begin();
+            router_data.mapped_route_count = routes.end() - routes.begin();
+        }
+        const auto hierarchy_edges = base.GetSection<TransportRouter::Hierarchy::HierarchyEdge>(Section::HIERARCHY_EDGES);
+        router_data.hierarchy.edges = { hierarchy_edges.begin(), hierarchy_edges.end() };
+        const auto upward_offsets = base.GetSection<size_t>(Section::HIERARCHY_UPWARD_OFFSETS);
+        const auto upward_edges = base.GetSection<graph::EdgeId>(Section::HIERARCHY_UPWARD_EDGES);
+        router_data.hierarchy.upward = { { upward_offsets.begin(), upward_offsets.end() }, { upward_edges.begin(), upward_edges.end() } };
+        const auto downward_offsets = base.GetSection<size_t>(Section::HIERARCHY_DOWNWARD_OFFSETS);
+        const auto downward_edges = base.GetSection<graph::EdgeId>(Section::HIERARCHY_DOWNWARD_EDGES);
+        router_data.hierarchy.downward = { { downward_offsets.begin(), downward_offsets.end() }, { downward_edges.begin(), downward_edges.end() } };
+        if (!router_data.hierarchy.edges.empty())
+        {
+            // A shortcut is made of hierarchy edges added before it
+            for (size_t i = 0; i < router_data.hierarchy.edges.size(); ++i)
+            {
+                const auto& edge = router_data.hierarchy.edges[i];
+                CheckIndex(edge.from, vertex_count);
+                CheckIndex(edge.to, vertex_count);
+                if (edge.second == TransportRouter::Hierarchy::NO_EDGE)
+                {
+                    CheckIndex(edge.first, edges_info.size());
+                }
+                else
+                {
+                    CheckIndex(edge.first, i);
+                    CheckIndex(edge.second, i);
+                }
+            }
+            for (const auto* search_graph : { &router_data.hierarchy.upward, &router_data.hierarchy.downward })
+            {
+                if (search_graph->offsets.size() != vertex_count + 1 || search_graph->offsets.front() != 0)
+                {
+                    throw std::runtime_error("Base file is corrupted");
+                }
+                for (size_t i = 1; i < search_graph->offsets.size(); ++i)
+                {
+                    CheckRange(search_graph->offsets[i - 1], search_graph->offsets[i], search_graph->edges.size());
+                }
+                for (const graph::EdgeId edge : search_graph->edges)
+                {
+                    CheckIndex(edge, router_data.hierarchy.edges.size());
+                }
+            }
+        }
+
+        tr_ = std::make_unique<transport_router::TransportRouter>(tc_, std::move(routing_settings)
+            , std::move(stops_vertex_id), std::move(vertices_info), std::move(edges_info)
+            , std::move(graph), std::move(router_data));
+    }
+
+    void Deserialization::PrintStatRequest() const
     {
         RequestHandler rh(tc_, renderer_, *tr_);
-        stat_request::PrintStatDoc(rh, rr_.GetStatRequest());
+        stat_request::PrintStatDoc(rh, rr_.GetStatRequest(), std::cout, rr_.GetPrintStyle(), rr_.GetThreadCount());
+        if (const auto stats = tr_->GetRouteCacheStats())
+        {
+            std::cerr << "Route cache: " << stats->hits << " hits, " << stats->misses << " misses" << std::endl;
+        }
     }
 
 }//----------------------end namespace deserialization
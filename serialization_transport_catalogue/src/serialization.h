@@ -1,10 +1,12 @@
 #pragma once
 #include "transport_catalogue.pb.h"
+#include "mapped_base.h"
 #include "transport_router.h"
 #include "map_renderer.h"
 #include "json_reader.h"
 #include "request_handler.h"
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <unordered_map>
@@ -18,30 +20,32 @@ namespace serialization
         using StopName = std::string;
         using StopsVertexId = std::unordered_map<StopName, graph::VertexId>;
         using Vertices = std::vector<StopName>;
-        using StopPtr = transport_catalogue::StopPtr;
-        using StopHasher = transport_catalogue::StopHasher;
-        using StopPtrEqual = transport_catalogue::StopPtrEqual;
-        using MapDistanceTransportCatalogue = std::unordered_map<std::pair<StopPtr, StopPtr>, int, StopHasher, StopPtrEqual>;
-        using RoutesInternalData = std::vector<std::vector<std::optional<graph::Router<double>::RouteInternalData>>>;
+        using MapDistanceTransportCatalogue = transport_catalogue::MapDistance;
+        using RoutesInternalData = ranges::Range<const graph::Router<double>::RouteInternalData*>;
 
         Serialization() = delete;
 
         Serialization(const request::RequestReader& rr, const transport_catalogue::TransportCatalogue& tc);
 
         void AddProtoBus(transport_catalogue_proto::TransportCatalogue& tc_proto
-            , const std::deque<transport_catalogue::Bus>& buses);
+            , transport_catalogue::TransportCatalogue::BusesRange buses);
 
         void AddProtoStop(transport_catalogue_proto::TransportCatalogue& tc_proto
-            , const std::deque<transport_catalogue::Stop>& stops);
+            , transport_catalogue::TransportCatalogue::StopsRange stops);
 
         void AddProtoDistanceFromTo(transport_catalogue_proto::TransportCatalogue& tc_proto
             , const MapDistanceTransportCatalogue& distances);
 
+        void AddProtoStopBuses(transport_catalogue_proto::TransportCatalogue& tc_proto);
+
         transport_catalogue_proto::Color SaveColor(const svg::Color& color);
 
         void SaveMap(transport_catalogue_proto::TransportCatalogue& tc_proto
             , const renderer::RenderSettings& settings);
 
+        // Renders the map and packs it as the map storage of the request says.
+        transport_catalogue_proto::RenderedMap RenderMap() const;
+
         void AddProtoRouterGraphEdges(transport_catalogue_proto::TransportRouter& router
             , std::vector<graph::Edge<double>> edges);
 
@@ -63,17 +67,21 @@ namespace serialization
         void AddProtoRouterRoutingSettings(transport_catalogue_proto::TransportRouter& router
             , const domain::RoutingSettings& routing_settings);
 
-        transport_catalogue_proto::RouterInternalData AddProtoRouterInternalData
-        (const std::optional<transport_router::TransportRouter::Router::RouteInternalData>& one_data);
+        void AddProtoRouterData(transport_catalogue_proto::TransportRouter& router, const RoutesInternalData& all_data);
 
-        transport_catalogue_proto::VectorRouterInternalData AddProtoRouterVectorRouterInternalData
-        (const std::vector<std::optional<graph::Router<double>::RouteInternalData>>& data);
+        void AddProtoHierarchySearchGraph(transport_catalogue_proto::HierarchySearchGraph& graph_proto
+            , const transport_router::TransportRouter::Hierarchy::SearchGraph& search_graph);
 
-        void AddProtoRouterData(transport_catalogue_proto::TransportRouter& router, const RoutesInternalData& all_data);
+        void AddProtoRouterHierarchy(transport_catalogue_proto::TransportRouter& router
+            , const transport_router::TransportRouter::Hierarchy& hierarchy);
 
         void GreateProtoTransportRouter(transport_catalogue_proto::TransportCatalogue& tc_proto
             , const transport_catalogue::TransportCatalogue& db, const domain::RoutingSettings& routing_settings);
 
+        void SaveMappedBase(const domain::RoutingSettings& routing_settings);
+
+        void AddMappedRouter(mapped_base::Writer& writer, const transport_router::TransportRouter& tr);
+
     private:
         const request::RequestReader& rr_;
         const transport_catalogue::TransportCatalogue& tc_;
@@ -108,35 +116,47 @@ namespace deserialization
 
         void CreateTransportCatalogue(std::vector<Bus>&& buses, std::vector<Stop>&& stops, const MapDistanceBetwinStops& dist_betw_stops);
 
+        void LoadBusStats(const transport_catalogue_proto::TransportCatalogue& tc_proto);
+
+        void LoadStopBuses(const transport_catalogue_proto::TransportCatalogue& tc_proto);
+
         svg::Color LoadColor(const transport_catalogue_proto::Color& color);
 
         void CreateRenderSettings(const transport_catalogue_proto::Map& map);
 
         std::vector<graph::Edge<double>> AddEdges(const transport_catalogue_proto::TransportRouter& router);       
 
-        std::vector<std::vector<graph::EdgeId>> AddInclidenceLists(const transport_catalogue_proto::TransportRouter& router);        
-
         std::unordered_map<StopName, graph::VertexId> AddStopsVertexId(const transport_catalogue_proto::TransportRouter& router);       
 
         std::vector<StopName> AddVertexInfo(const transport_catalogue_proto::TransportRouter& router);       
 
         std::vector<transport_router::TransportRouter::EdgeInfo> AddEdgesInfo(const transport_catalogue_proto::TransportRouter& router);        
 
-        std::vector<std::optional<graph::Router<double>::RouteInternalData>> AddRouteInternalData(const transport_catalogue_proto::VectorRouterInternalData& data_proto);        
-
         graph::Router<double>::RoutesInternalData AddRoutersInternalData(const transport_catalogue_proto::TransportRouter& router);
+
+        transport_router::TransportRouter::Hierarchy::SearchGraph AddHierarchySearchGraph
+        (const transport_catalogue_proto::HierarchySearchGraph& graph_proto);
+
+        transport_router::TransportRouter::HierarchyData AddHierarchy(const transport_catalogue_proto::TransportRouter& router);
        
         domain::RoutingSettings AddRoutinSettings(const transport_catalogue_proto::TransportRouter& router);
         
         void CreateTransportRouter(const transport_catalogue_proto::TransportRouter& router_proto);
 
-        void PrintStatRequest() const noexcept;       
+        void LoadMappedBase();
+
+        void LoadMappedCatalogue(const mapped_base::Reader& base);
+
+        void CreateMappedTransportRouter(const mapped_base::Reader& base);
+
+        void PrintStatRequest() const;       
         
     private:
         const request::RequestReader& rr_;
         transport_catalogue::TransportCatalogue tc_;
         renderer::RenderSettings settings_;
         renderer::MapRenderer renderer_;
+        std::unique_ptr<mapped_base::Reader> mapped_base_;
         std::unique_ptr<transport_router::TransportRouter> tr_ ;
     };
 }
\ No newline at end of file
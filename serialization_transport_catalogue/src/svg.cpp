@@ -15,6 +15,39 @@ namespace svg {
         RenderObject(context);
     }
 
+    void RenderPathAttrs(std::ostream& out, const Color& fill_color, const Color& stroke_color, double width
+        , const std::optional<StrokeLineCap>& line_cap, const std::optional<StrokeLineJoin>& line_join)
+    {
+        if (!std::holds_alternative<std::monostate>(fill_color))
+        {
+            out << " fill=\""sv;
+            std::visit(Visiter{ out }, fill_color);
+            out << "\""sv;
+        }
+
+        if (!std::holds_alternative<std::monostate>(stroke_color))
+        {
+            out << " stroke=\""sv;
+            std::visit(Visiter{ out }, stroke_color);
+            out << "\""sv;
+        }
+
+        if (width)
+        {
+            out << " stroke-width=\""sv << width << "\""sv;
+        }
+
+        if (line_cap != std::nullopt)
+        {
+            out << " stroke-linecap=\""sv << *line_cap << "\""sv;
+        }
+
+        if (line_join != std::nullopt)
+        {
+            out << " stroke-linejoin=\""sv << *line_join << "\""sv;
+        }
+    }
+
     //---------------Point------------------
 
     Point::Point(double x, double y)
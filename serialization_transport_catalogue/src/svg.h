@@ -184,6 +184,10 @@ namespace svg
         int indent = 0;
     };
 
+    // Writes the fill, stroke and stroke-* attributes which are set, each with a leading space.
+    void RenderPathAttrs(std::ostream& out, const Color& fill_color, const Color& stroke_color, double width
+        , const std::optional<StrokeLineCap>& line_cap, const std::optional<StrokeLineJoin>& line_join);
+
     template <typename Owner>
     class PathProps
     {
@@ -231,36 +235,7 @@ namespace svg
 
         void RenderAttrs(const RenderContext& context)const
         {
-            auto& out = context.out;
-
-            if (!std::holds_alternative<std::monostate>(fill_color_))
-            {
-                out << " fill=\""sv;
-                std::visit(Visiter{ out }, fill_color_);
-                out << "\""sv;
-            }
-
-            if (!std::holds_alternative<std::monostate>(stroke_color_))
-            {
-                out << " stroke=\""sv;
-                std::visit(Visiter{ out }, stroke_color_);
-                out << "\""sv;
-            }
-
-            if (width_)
-            {
-                out << " stroke-width=\""sv << width_ << "\""sv;
-            }
-
-            if (line_cap_ != std::nullopt)
-            {
-                out << " stroke-linecap=\""sv << *line_cap_ << "\""sv;
-            }
-
-            if (line_join_ != std::nullopt)
-            {
-                out << " stroke-linejoin=\""sv << *line_join_ << "\""sv;
-            }
+            RenderPathAttrs(context.out, fill_color_, stroke_color_, width_, line_cap_, line_join_);
         }
 
         Color fill_color_;
@@ -0,0 +1,169 @@
+#include "svg_flat.h"
+
+#include <charconv>
+#include <iterator>
+#include <sstream>
+
+namespace svg
+{
+
+    namespace
+    {
+        using namespace std::literals;
+
+        // Same text as std::ostream gives with its default precision
+        void AppendNumber(std::string& out, double value)
+        {
+            char chars[32];
+            const auto result = std::to_chars(std::begin(chars), std::end(chars), value, std::chars_format::general, 6);
+            out.append(chars, result.ptr);
+        }
+
+        void AppendPoint(std::string& out, Point point, std::string_view separator)
+        {
+            AppendNumber(out, point.x);
+            out += separator;
+            AppendNumber(out, point.y);
+        }
+
+        std::string RenderPathStyle(const PathStyle& style)
+        {
+            std::ostringstream out;
+            RenderPathAttrs(out, style.fill_color, style.stroke_color, style.stroke_width, style.line_cap, style.line_join);
+            return out.str();
+        }
+
+        // Upper bound of the text of a number
+        constexpr size_t NUMBER_SIZE = 16;
+
+        constexpr std::string_view TEXT_END = "</text>\n  "sv;
+    }
+
+    FlatDocument::StyleId FlatDocument::AddCircleStyle(double radius, const PathStyle& style)
+    {
+        std::ostringstream suffix;
+        suffix << "\" r=\""sv << radius << "\""sv << RenderPathStyle(style) << "/>\n "sv;
+        return AddStyle(" <circle cx=\""s, suffix.str());
+    }
+
+    FlatDocument::StyleId FlatDocument::AddPolylineStyle(const PathStyle& style)
+    {
+        return AddStyle("<polyline points=\""s, "\""s + RenderPathStyle(style) + "/>\n  "s);
+    }
+
+    FlatDocument::StyleId FlatDocument::AddTextStyle(const FontStyle& font, const PathStyle& style)
+    {
+        std::ostringstream suffix;
+        suffix << "\" dx=\""sv << font.offset.x << "\" dy=\""sv << font.offset.y << "\" "sv;
+        suffix << "font-size=\""sv << font.font_size << "\""sv;
+        if (font.font_family.length())
+        {
+            suffix << " font-family=\""sv << font.font_family << "\""sv;
+        }
+        if (font.font_weight.length())
+        {
+            suffix << " font-weight=\""sv << font.font_weight << "\""sv;
+        }
+        suffix << ">"sv;
+        return AddStyle("<text"s + RenderPathStyle(style) + " x=\""s, suffix.str());
+    }
+
+    void FlatDocument::AddCircle(Point center, StyleId style)
+    {
+        circles_.push_back({ center, style });
+        AddToRun(ShapeKind::CIRCLE);
+    }
+
+    void FlatDocument::AddText(Point pos, std::string_view data, StyleId style)
+    {
+        texts_.push_back({ pos, static_cast<std::uint32_t>(chars_.size()), static_cast<std::uint32_t>(data.size()), style });
+        chars_ += data;
+        AddToRun(ShapeKind::TEXT);
+    }
+
+    void FlatDocument::Render(std::string& out) const
+    {
+        size_t size = chars_.size() + NUMBER_SIZE * 2 * (circles_.size() + points_.size() + texts_.size());
+        for (const CircleShape& circle : circles_)
+        {
+            size += styles_[circle.style].prefix.size() + styles_[circle.style].suffix.size();
+        }
+        for (const PolylineShape& polyline : polylines_)
+        {
+            size += styles_[polyline.style].prefix.size() + styles_[polyline.style].suffix.size();
+        }
+        for (const TextShape& text : texts_)
+        {
+            size += styles_[text.style].prefix.size() + styles_[text.style].suffix.size() + TEXT_END.size();
+        }
+        out.reserve(out.size() + size + 128);
+
+        out += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+        out += "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n  "sv;
+        const CircleShape* circle = circles_.data();
+        const PolylineShape* polyline = polylines_.data();
+        const TextShape* text = texts_.data();
+        for (const ShapeRun& run : runs_)
+        {
+            for (std::uint32_t i = 0; i < run.count; ++i)
+            {
+                switch (run.kind)
+                {
+                case ShapeKind::CIRCLE:
+                {
+                    const StyleRecord& style = styles_[circle->style];
+                    out += style.prefix;
+                    AppendPoint(out, circle->center, "\" cy=\""sv);
+                    out += style.suffix;
+                    ++circle;
+                    break;
+                }
+                case ShapeKind::POLYLINE:
+                {
+                    const StyleRecord& style = styles_[polyline->style];
+                    out += style.prefix;
+                    for (std::uint32_t point = polyline->points_begin; point < polyline->points_end; ++point)
+                    {
+                        if (point != polyline->points_begin)
+                        {
+                            out += ' ';
+                        }
+                        AppendPoint(out, points_[point], ","sv);
+                    }
+                    out += style.suffix;
+                    ++polyline;
+                    break;
+                }
+                case ShapeKind::TEXT:
+                {
+                    const StyleRecord& style = styles_[text->style];
+                    out += style.prefix;
+                    AppendPoint(out, text->pos, "\" y=\""sv);
+                    out += style.suffix;
+                    out.append(chars_, text->data_begin, text->data_size);
+                    out += TEXT_END;
+                    ++text;
+                    break;
+                }
+                }
+            }
+        }
+        out += "</svg>"sv;
+    }
+
+    FlatDocument::StyleId FlatDocument::AddStyle(std::string prefix, std::string suffix)
+    {
+        styles_.push_back({ std::move(prefix), std::move(suffix) });
+        return static_cast<StyleId>(styles_.size() - 1);
+    }
+
+    void FlatDocument::AddToRun(ShapeKind kind)
+    {
+        if (runs_.empty() || runs_.back().kind != kind)
+        {
+            runs_.push_back({ kind, 0 });
+        }
+        ++runs_.back().count;
+    }
+
+}  // namespace svg
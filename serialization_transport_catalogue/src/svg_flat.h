@@ -0,0 +1,122 @@
+#pragma once
+#include "svg.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// SVG document for pictures of many shapes. Shapes of a kind are kept in one array with
+// their geometry only, the attributes they share are rendered once into style records.
+// Render writes straight into a string and gives the same text as svg::Document with
+// the same shapes.
+namespace svg
+{
+
+    // Attributes of svg::PathProps.
+    struct PathStyle
+    {
+        Color fill_color{};
+        Color stroke_color{};
+        double stroke_width = 0;
+        std::optional<StrokeLineCap> line_cap{};
+        std::optional<StrokeLineJoin> line_join{};
+    };
+
+    // Attributes of svg::Text but the position and the data.
+    struct FontStyle
+    {
+        Point offset{};
+        double font_size = 1;
+        std::string font_family{};
+        std::string font_weight{};
+    };
+
+    class FlatDocument
+    {
+    public:
+        using StyleId = std::uint32_t;
+
+        StyleId AddCircleStyle(double radius, const PathStyle& style);
+
+        StyleId AddPolylineStyle(const PathStyle& style);
+
+        StyleId AddTextStyle(const FontStyle& font, const PathStyle& style);
+
+        void AddCircle(Point center, StyleId style);
+
+        template <typename PointIt>
+        void AddPolyline(PointIt points_begin, PointIt points_end, StyleId style);
+
+        void AddText(Point pos, std::string_view data, StyleId style);
+
+        // Appends the document to out.
+        void Render(std::string& out) const;
+
+    private:
+        enum class ShapeKind : std::uint8_t
+        {
+            CIRCLE,
+            POLYLINE,
+            TEXT
+        };
+
+        // Text of a shape is prefix, the geometry and suffix
+        struct StyleRecord
+        {
+            std::string prefix;
+            std::string suffix;
+        };
+
+        struct CircleShape
+        {
+            Point center;
+            StyleId style = 0;
+        };
+
+        struct PolylineShape
+        {
+            std::uint32_t points_begin = 0;
+            std::uint32_t points_end = 0;
+            StyleId style = 0;
+        };
+
+        struct TextShape
+        {
+            Point pos;
+            std::uint32_t data_begin = 0;
+            std::uint32_t data_size = 0;
+            StyleId style = 0;
+        };
+
+        // Shapes are drawn in the order they are added: runs of shapes of one kind in turn
+        struct ShapeRun
+        {
+            ShapeKind kind;
+            std::uint32_t count = 0;
+        };
+
+        StyleId AddStyle(std::string prefix, std::string suffix);
+
+        void AddToRun(ShapeKind kind);
+
+        std::vector<StyleRecord> styles_;
+        std::vector<CircleShape> circles_;
+        std::vector<PolylineShape> polylines_;
+        std::vector<Point> points_;
+        std::vector<TextShape> texts_;
+        std::string chars_;
+        std::vector<ShapeRun> runs_;
+    };
+
+    template <typename PointIt>
+    void FlatDocument::AddPolyline(PointIt points_begin, PointIt points_end, StyleId style)
+    {
+        const auto begin = static_cast<std::uint32_t>(points_.size());
+        points_.insert(points_.end(), points_begin, points_end);
+        polylines_.push_back({ begin, static_cast<std::uint32_t>(points_.size()), style });
+        AddToRun(ShapeKind::POLYLINE);
+    }
+
+}  // namespace svg
@@ -0,0 +1,113 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace thread_pool
+{
+
+    ThreadPool::ThreadPool(size_t thread_count)
+    {
+        if (thread_count == 0)
+        {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        workers_.reserve(thread_count - 1);
+        for (size_t i = 1; i < thread_count; ++i)
+        {
+            workers_.emplace_back([this]
+                {
+                    WorkerLoop();
+                });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (std::thread& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::Run(size_t count, const std::function<void(size_t)>& task)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            task_ = &task;
+            count_ = count;
+            next_index_ = 0;
+            busy_workers_ = workers_.size();
+            error_ = nullptr;
+            ++generation_;
+        }
+        start_.notify_all();
+
+        Work();
+
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [this]
+            {
+                return busy_workers_ == 0;
+            });
+        task_ = nullptr;
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    void ThreadPool::WorkerLoop()
+    {
+        std::uint64_t seen_generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock lock(mutex_);
+                start_.wait(lock, [this, seen_generation]
+                    {
+                        return stop_ || generation_ != seen_generation;
+                    });
+                if (stop_)
+                {
+                    return;
+                }
+                seen_generation = generation_;
+            }
+
+            Work();
+
+            {
+                std::lock_guard lock(mutex_);
+                --busy_workers_;
+            }
+            done_.notify_one();
+        }
+    }
+
+    void ThreadPool::Work()
+    {
+        for (size_t index = next_index_++; index < count_; index = next_index_++)
+        {
+            try
+            {
+                (*task_)(index);
+            }
+            catch (...)
+            {
+                std::lock_guard lock(mutex_);
+                if (!error_)
+                {
+                    error_ = std::current_exception();
+                }
+                // Stops handing out the remaining indices
+                next_index_ = count_;
+            }
+        }
+    }
+
+}  // namespace thread_pool
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace thread_pool
+{
+
+    // Fixed set of worker threads running index loops. The calling thread takes part
+    // in every loop, so a pool of one thread has no workers and runs loops in place.
+    class ThreadPool
+    {
+    public:
+        // Zero means one thread per hardware core.
+        explicit ThreadPool(size_t thread_count);
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool();
+
+        size_t GetThreadCount() const noexcept
+        {
+            return workers_.size() + 1;
+        }
+
+        // Calls task(index) for every index in [0, count) and waits until all calls
+        // are done. The first exception thrown by a task is rethrown here.
+        template <typename Task>
+        void ParallelFor(size_t count, const Task& task)
+        {
+            if (workers_.empty() || count < 2)
+            {
+                for (size_t index = 0; index < count; ++index)
+                {
+                    task(index);
+                }
+                return;
+            }
+            Run(count, std::function<void(size_t)>(std::cref(task)));
+        }
+
+    private:
+        void Run(size_t count, const std::function<void(size_t)>& task);
+
+        void WorkerLoop();
+
+        // Takes indices of the current loop until there are none left.
+        void Work();
+
+        std::vector<std::thread> workers_;
+        std::mutex mutex_;
+        std::condition_variable start_;
+        std::condition_variable done_;
+
+        const std::function<void(size_t)>* task_ = nullptr;
+        size_t count_ = 0;
+        std::atomic<size_t> next_index_ = 0;
+        size_t busy_workers_ = 0;
+        std::uint64_t generation_ = 0;
+        bool stop_ = false;
+        std::exception_ptr error_;
+    };
+
+}  // namespace thread_pool
@@ -4,45 +4,70 @@ using namespace transport_catalogue;
 
 StopPtr transport_catalogue::TransportCatalogue::FindStop(const std::string_view& stop) const noexcept
 {
-	if (name_stop_.count(stop) != 0)
+	const auto id = FindStopId(stop);
+	return id ? &stops_[*id] : nullptr;
+}
+
+BusPtr transport_catalogue::TransportCatalogue::FindBus(const std::string_view& buss) const noexcept
+{
+	const auto id = FindBusId(buss);
+	return id ? &buses_[*id] : nullptr;
+}
+
+std::optional<StopId> transport_catalogue::TransportCatalogue::FindStopId(std::string_view stop) const noexcept
+{
+	const auto it = name_stop_.find(stop);
+	if (it == name_stop_.end())
 	{
-		return name_stop_.at(stop);
+		return std::nullopt;
 	}
-	return nullptr;
+	return it->second;
 }
 
-BusPtr transport_catalogue::TransportCatalogue::FindBus(const std::string_view& buss) const noexcept
+std::optional<BusId> transport_catalogue::TransportCatalogue::FindBusId(std::string_view bus) const noexcept
 {
-	if (name_bus_.count(buss) != 0)
+	const auto it = name_bus_.find(bus);
+	if (it == name_bus_.end())
 	{
-		return name_bus_.at(buss);
+		return std::nullopt;
 	}
-	return nullptr;
+	return it->second;
 }
 
-int transport_catalogue::TransportCatalogue::FindDistanceBetweenStops(const std::pair<StopPtr, StopPtr>& stops) const noexcept
+const Stop& transport_catalogue::TransportCatalogue::GetStopById(StopId id) const
 {
-	if (dist_betw_stops_.find(stops) != dist_betw_stops_.end())
+	return stops_.at(id);
+}
+
+const Bus& transport_catalogue::TransportCatalogue::GetBusById(BusId id) const
+{
+	return buses_.at(id);
+}
+
+int transport_catalogue::TransportCatalogue::FindDistanceBetweenStops(StopId from, StopId to) const noexcept
+{
+	if (const auto it = dist_betw_stops_.find({ from, to }); it != dist_betw_stops_.end())
 	{
-		return dist_betw_stops_.at(stops);
+		return it->second;
 	}
-	else
+	if (const auto it = dist_betw_stops_.find({ to, from }); it != dist_betw_stops_.end())
 	{
-		std::pair<StopPtr, StopPtr> temp{ stops.second, stops.first };
-		return dist_betw_stops_.at(temp);
+		return it->second;
 	}
+	return 0;
 }
 
 void transport_catalogue::TransportCatalogue::AddStop(std::pair<double, double> coordinats, std::string&& stop) noexcept
 {
-	stops_.push_back({ std::move(stop), {coordinats.first, coordinats.second} });
-	name_stop_.insert({ stops_.back().name, &stops_.back() });
-	stop_to_buses_.insert({ &stops_.back(), {} });
+	const StopId id = static_cast<StopId>(stops_.size());
+	stops_.push_back({ std::move(stop), {coordinats.first, coordinats.second}, id });
+	name_stop_.insert({ stops_.back().name, id });
 }
 
 void transport_catalogue::TransportCatalogue::AddBus(std::string&& name_bus, std::vector<std::string>&& stops_for_bus, bool is_ring, std::string&& name_last_stop) noexcept
 {
 	Bus temp;
+	temp.id = static_cast<BusId>(buses_.size());
 	buses_.push_back(std::move(temp));
 	buses_.back().name = std::move(name_bus);
 	buses_.back().is_roundtrip = is_ring;
@@ -51,47 +76,143 @@ void transport_catalogue::TransportCatalogue::AddBus(std::string&& name_bus, std
 
 	for (auto it = stops_for_bus.begin(); it != stops_for_bus.end(); ++it)
 	{
-		buses_.back().stops.push_back(std::move(name_stop_.at(*it)));
-		stop_to_buses_[name_stop_.at(*it)].insert(&buses_.back());
+		const StopId stop = name_stop_.at(*it);
+		buses_.back().stops.push_back(&stops_[stop]);
 	}
-	name_bus_.insert({ buses_.back().name, &buses_.back() });
+	name_bus_.insert({ buses_.back().name, buses_.back().id });
+	bus_stats_.emplace_back();
 }
 
 void transport_catalogue::TransportCatalogue::AddDistanceBetweenStops(std::string_view nameStop, const std::vector<domain::NearestStop>& distance_to_nearest_stops) noexcept
 {
-	StopPtr stop1 = FindStop(nameStop);
+	const StopId stop1 = name_stop_.at(nameStop);
 	for (auto it = distance_to_nearest_stops.begin(); it != distance_to_nearest_stops.end(); ++it)
 	{
-		StopPtr stop2 = FindStop(it->name_nearest_stop);
+		const StopId stop2 = name_stop_.at(it->name_nearest_stop);
 		dist_betw_stops_.insert({ {stop1, stop2}, it->distance_to_nearest_stop });
 	}
 }
 
-std::deque<Bus> transport_catalogue::TransportCatalogue::GetRoute() const noexcept
+TransportCatalogue::BusesRange transport_catalogue::TransportCatalogue::GetRoute() const noexcept
+{
+	return ranges::AsRange(buses_);
+}
+
+TransportCatalogue::StopsRange transport_catalogue::TransportCatalogue::GetStop() const noexcept
+{
+	return ranges::AsRange(stops_);
+}
+
+size_t transport_catalogue::TransportCatalogue::GetBusCount() const noexcept
+{
+	return buses_.size();
+}
+
+size_t transport_catalogue::TransportCatalogue::GetStopCount() const noexcept
+{
+	return stops_.size();
+}
+
+BusIdsRange transport_catalogue::TransportCatalogue::GetBusesByStop(StopId stop) const noexcept
+{
+	if (stop + 1 >= stop_buses_offsets_.size())
+	{
+		return { nullptr, nullptr };
+	}
+	const BusId* ids = stop_buses_.data();
+	return { ids + stop_buses_offsets_[stop], ids + stop_buses_offsets_[stop + 1] };
+}
+
+const std::vector<std::uint32_t>& transport_catalogue::TransportCatalogue::GetStopBusesOffsets() const noexcept
+{
+	return stop_buses_offsets_;
+}
+
+const std::vector<BusId>& transport_catalogue::TransportCatalogue::GetStopBuses() const noexcept
+{
+	return stop_buses_;
+}
+
+void transport_catalogue::TransportCatalogue::SetStopBuses(std::vector<std::uint32_t>&& offsets, std::vector<BusId>&& ids)
+{
+	if (offsets.size() != stops_.size() + 1 || offsets.back() != ids.size())
+	{
+		throw std::invalid_argument("Stop buses do not match the catalogue");
+	}
+	stop_buses_offsets_ = std::move(offsets);
+	stop_buses_ = std::move(ids);
+}
+
+void transport_catalogue::TransportCatalogue::ComputeStopBuses()
+{
+	std::vector<BusId> buses_by_name(buses_.size());
+	std::iota(buses_by_name.begin(), buses_by_name.end(), 0);
+	std::sort(buses_by_name.begin(), buses_by_name.end(), [this](BusId lhs, BusId rhs)
+		{
+			return buses_[lhs].name < buses_[rhs].name;
+		});
+
+	// Visiting buses in name order keeps every stop's list sorted; a bus passing the
+	// stop several times is recorded once thanks to last_bus.
+	std::vector<std::uint32_t> counts(stops_.size() + 1);
+	std::vector<std::optional<BusId>> last_bus(stops_.size());
+	for (const BusId bus : buses_by_name)
+	{
+		for (const StopPtr stop : buses_[bus].stops)
+		{
+			if (last_bus[stop->id] != bus)
+			{
+				last_bus[stop->id] = bus;
+				++counts[stop->id + 1];
+			}
+		}
+	}
+	std::partial_sum(counts.begin(), counts.end(), counts.begin());
+
+	std::vector<BusId> ids(counts.back());
+	std::vector<std::uint32_t> positions(counts.begin(), counts.end() - 1);
+	std::fill(last_bus.begin(), last_bus.end(), std::nullopt);
+	for (const BusId bus : buses_by_name)
+	{
+		for (const StopPtr stop : buses_[bus].stops)
+		{
+			if (last_bus[stop->id] != bus)
+			{
+				last_bus[stop->id] = bus;
+				ids[positions[stop->id]++] = bus;
+			}
+		}
+	}
+	stop_buses_offsets_ = std::move(counts);
+	stop_buses_ = std::move(ids);
+}
+
+const BusStat& transport_catalogue::TransportCatalogue::GetBusStat(BusId bus) const
 {
-	return buses_;
+	return bus_stats_.at(bus);
 }
 
-std::deque<Stop> transport_catalogue::TransportCatalogue::GetStop() const noexcept
+void transport_catalogue::TransportCatalogue::SetBusStat(BusId bus, const BusStat& stat)
 {
-	return stops_;
+	bus_stats_.at(bus) = stat;
 }
 
-const std::unordered_set<BusPtr>& transport_catalogue::TransportCatalogue::GetBusesByStop(StopPtr stop) const noexcept
+void transport_catalogue::TransportCatalogue::ComputeBusStats()
 {
-	static const std::unordered_set<BusPtr> temp;
-	auto iter = stop_to_buses_.find(stop);
-	return iter == stop_to_buses_.end() ? temp : iter->second;
+	for (const auto& bus : buses_)
+	{
+		bus_stats_[bus.id] = ComputeBusStat(bus);
+	}
 }
 
-BusStat transport_catalogue::TransportCatalogue::GetStat(transport_catalogue::BusPtr bus) const
+BusStat transport_catalogue::TransportCatalogue::ComputeBusStat(const Bus& bus) const
 {
 	BusStat stat;
 
 	std::unordered_set<std::string_view> seen_stops;
 	std::optional<geo::Coordinates> prev_pos;
 
-	for (const auto& stop : bus->stops)
+	for (const auto& stop : bus.stops)
 	{
 		++stat.total_stops;
 
@@ -109,58 +230,31 @@ BusStat transport_catalogue::TransportCatalogue::GetStat(transport_catalogue::Bu
 		prev_pos = stop->coordinates;
 	}
 
-	for (auto it = bus->stops.begin(); it != bus->stops.end() - 1; ++it)
+	for (auto it = bus.stops.begin(); it + 1 < bus.stops.end(); ++it)
 	{
-		std::pair<StopPtr, StopPtr> temp{ *it, *(it + 1) };
-		stat.distance += FindDistanceBetweenStops(temp);
+		stat.distance += FindDistanceBetweenStops((*it)->id, (*(it + 1))->id);
 	}
 
 	return stat;
 }
 
-const std::unordered_map<StopPtr, std::unordered_set<BusPtr>>& transport_catalogue::TransportCatalogue::GetStopToBuses() const noexcept
+size_t transport_catalogue::StopIdPairHasher::operator()(const StopIdPair& stops) const noexcept
 {
-	return stop_to_buses_;
-}
-
-size_t transport_catalogue::StopHasher::operator()(const std::pair<StopPtr, StopPtr>& stops) const noexcept
-{
-	{
-		std::hash<std::string>hstr;
-		std::hash<double> hdouble;
-		return static_cast<size_t>(hstr(stops.first->name))
-			+ static_cast<size_t>(hstr(stops.second->name))
-			+ static_cast<size_t>(hdouble(stops.first->coordinates.lat))
-			+ static_cast<size_t>(hdouble(stops.first->coordinates.lng))
-			+ static_cast<size_t>(hdouble(stops.second->coordinates.lat))
-			+ static_cast<size_t>(hdouble(stops.second->coordinates.lng));
-	}
-}
-
-size_t TransportCatalogue::GetDistanceBetweenStops(const transport_catalogue::Stop& stop1, const transport_catalogue::Stop& stop2) const noexcept
-{
-
-	auto stops = std::make_pair(&stop1, &stop2);
-	if(dist_betw_stops_.find(stops) != dist_betw_stops_.end())
-	{		
-		return dist_betw_stops_.at(stops);
-	}
-	stops = std::make_pair(&stop2, &stop1);
-	if(dist_betw_stops_.find(stops) != dist_betw_stops_.end())
-	{
-		return dist_betw_stops_.at(stops);
-	}
-	return 0;
+	std::uint64_t key = (static_cast<std::uint64_t>(stops.first) << 32) | stops.second;
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return static_cast<size_t>(key);
 }
 
-const std::unordered_map<std::pair<StopPtr, StopPtr>, int, StopHasher, StopPtrEqual> transport_catalogue::TransportCatalogue::GetMapDistance() const noexcept
+const MapDistance& transport_catalogue::TransportCatalogue::GetMapDistance() const noexcept
 {	
 	return dist_betw_stops_;	
 }
 
-void transport_catalogue::TransportCatalogue::CreateDistBetweenStops(const StopPtr& lhs, const StopPtr& rhs, int dist)
+void transport_catalogue::TransportCatalogue::CreateDistBetweenStops(StopId from, StopId to, int dist)
 {
-	dist_betw_stops_.insert({ { lhs, rhs }, dist });
+	dist_betw_stops_.insert({ { from, to }, dist });
 }
 
 transport_catalogue::TransportCatalogue::TransportCatalogue(const std::vector<domain::BaseRequest>& requests)
@@ -173,7 +267,7 @@ transport_catalogue::TransportCatalogue::TransportCatalogue(const std::vector<do
 			if (stop.name_stop.length())
 			{
 				AddStop({ stop.latitude, stop.longitude }, std::move(stop.name_stop));
-				transport_catalogue::DistanceStop temp = { GetStop().back().name, stop.distance_to_nearest_stops };
+				transport_catalogue::DistanceStop temp = { stops_.back().name, stop.distance_to_nearest_stops };
 				dist_temp.push_back(std::move(temp));
 			}
 		}
@@ -188,5 +282,7 @@ transport_catalogue::TransportCatalogue::TransportCatalogue(const std::vector<do
 				AddBus(std::move(bus.name_bus), std::move(bus.stops_for_bus), bus.is_roundtrip, std::move(bus.name_last_stop));
 			}
 		}
+		ComputeBusStats();
+		ComputeStopBuses();
 	}
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -10,38 +11,38 @@
 #include <optional>
 #include <iomanip>
 #include <set>
+#include <stdexcept>
 
 
 #include "geo.h"
 #include "domain.h"
+#include "ranges.h"
 
 namespace transport_catalogue
 {
+	// Dense handles assigned in the order stops and buses are added to the catalogue.
+	using StopId = std::uint32_t;
+	using BusId = std::uint32_t;
+
 	struct Stop
 	{
 		std::string name;
 		geo::Coordinates coordinates{};
+		StopId id = 0;
 	};
 
 	using StopPtr = const transport_catalogue::Stop*;
 
-	struct StopHasher
-	{
-		size_t operator()(const std::pair<StopPtr, StopPtr>& stops) const noexcept;
-	};
+	// Road distance key: the stop it starts from and the stop it leads to.
+	using StopIdPair = std::pair<StopId, StopId>;
 
-	struct StopPtrEqual
+	struct StopIdPairHasher
 	{
-		bool operator() (const std::pair<transport_catalogue::StopPtr, transport_catalogue::StopPtr>& lhs
-			, const std::pair<transport_catalogue::StopPtr, transport_catalogue::StopPtr>& rhs)const noexcept
-		{
-			return lhs.first->name == rhs.first->name
-				&& lhs.first->coordinates == rhs.first->coordinates
-				&& lhs.second->name == rhs.second->name
-				&& lhs.second->coordinates == rhs.second->coordinates;
-		}
+		size_t operator()(const StopIdPair& stops) const noexcept;
 	};
 
+	using MapDistance = std::unordered_map<StopIdPair, int, StopIdPairHasher>;
+
 	struct Bus
 	{
 		std::string name;
@@ -50,14 +51,17 @@ namespace transport_catalogue
 		std::string name_first_stop;
 		std::string name_last_stop;
 		bool is_roundtrip = false;
+		BusId id = 0;
 	};
 
 	using BusPtr = const transport_catalogue::Bus*;
 
+	using BusIdsRange = ranges::Range<const BusId*>;
+
 	struct StopInfo
 	{
-		std::string about = "not found";
-		std::unordered_set<BusPtr> buses_for_stop;
+		std::string_view about = "not found";
+		BusIdsRange buses_for_stop{ nullptr, nullptr };
 	};
 
 	struct BusStat
@@ -77,6 +81,8 @@ namespace transport_catalogue
 	class TransportCatalogue
 	{
 	public:
+		using BusesRange = ranges::Range<std::deque<Bus>::const_iterator>;
+		using StopsRange = ranges::Range<std::deque<Stop>::const_iterator>;
 
 		TransportCatalogue() = default;
 
@@ -86,40 +92,72 @@ namespace transport_catalogue
 
 		BusPtr FindBus(const std::string_view& buss) const noexcept;
 
-		int FindDistanceBetweenStops(const std::pair<StopPtr, StopPtr>& stops)const noexcept;
+		std::optional<StopId> FindStopId(std::string_view stop) const noexcept;
+
+		std::optional<BusId> FindBusId(std::string_view bus) const noexcept;
+
+		const Stop& GetStopById(StopId id) const;
+
+		const Bus& GetBusById(BusId id) const;
 
-		inline void AddStop(std::pair<double, double> coordinats, std::string&& stop) noexcept;
+		// Distance from one stop to another, the reverse direction is used when the direct one
+		// is not set, 0 when neither is.
+		int FindDistanceBetweenStops(StopId from, StopId to) const noexcept;
 
-		inline void AddBus(std::string&& name_bus, std::vector<std::string>&& stops_for_bus, bool is_ring, std::string&& station_lost) noexcept;
+		void AddStop(std::pair<double, double> coordinats, std::string&& stop) noexcept;
 
-		inline void AddDistanceBetweenStops(std::string_view nameStop, const std::vector<domain::NearestStop>& stops_to_stop) noexcept;
+		void AddBus(std::string&& name_bus, std::vector<std::string>&& stops_for_bus, bool is_ring, std::string&& station_lost) noexcept;
 
-		std::deque<Bus> GetRoute() const noexcept;
+		void AddDistanceBetweenStops(std::string_view nameStop, const std::vector<domain::NearestStop>& stops_to_stop) noexcept;
 
-		std::deque<Stop> GetStop() const noexcept;
+		// Views over the catalogue storage, valid while the catalogue is alive and unchanged.
+		BusesRange GetRoute() const noexcept;
 
-		const std::unordered_set<BusPtr>& GetBusesByStop(StopPtr stop) const noexcept;
+		StopsRange GetStop() const noexcept;
 
-		inline BusStat GetStat(transport_catalogue::BusPtr bus) const;
+		size_t GetBusCount() const noexcept;
 
-		const std::unordered_map<StopPtr, std::unordered_set<BusPtr>>& GetStopToBuses()const noexcept;
+		size_t GetStopCount() const noexcept;
 
-		size_t GetDistanceBetweenStops(const transport_catalogue::Stop& stop1, const transport_catalogue::Stop& stop2) const noexcept;
+		// Ids of the buses passing through the stop, sorted by bus name.
+		BusIdsRange GetBusesByStop(StopId stop) const noexcept;
 
-		const std::unordered_map<std::pair<StopPtr, StopPtr>, int, StopHasher, StopPtrEqual> GetMapDistance() const noexcept;
+		// Buses of every stop in CSR form: buses of stop s are ids[offsets[s]] .. ids[offsets[s + 1] - 1].
+		const std::vector<std::uint32_t>& GetStopBusesOffsets() const noexcept;
+
+		const std::vector<BusId>& GetStopBuses() const noexcept;
+
+		void SetStopBuses(std::vector<std::uint32_t>&& offsets, std::vector<BusId>&& ids);
+
+		void ComputeStopBuses();
+
+		// Statistics are computed once for the whole catalogue (ComputeBusStats) or loaded
+		// from the base (SetBusStat), requests only read them.
+		const BusStat& GetBusStat(BusId bus) const;
+
+		void SetBusStat(BusId bus, const BusStat& stat);
+
+		void ComputeBusStats();
+
+		const MapDistance& GetMapDistance() const noexcept;
 		
-		void CreateDistBetweenStops(const StopPtr& lhs, const StopPtr& rhs, int dist);
+		void CreateDistBetweenStops(StopId from, StopId to, int dist);
 		
 	private:
+		BusStat ComputeBusStat(const Bus& bus) const;
+
 		std::deque<Bus> buses_;
 		std::deque<Stop> stops_;
 
-		std::unordered_map<StopPtr, std::unordered_set<BusPtr>> stop_to_buses_;
+		std::vector<std::uint32_t> stop_buses_offsets_;
+		std::vector<BusId> stop_buses_;
+		std::vector<BusStat> bus_stats_;
 
-		std::unordered_map<std::string_view, BusPtr> name_bus_;
-		std::unordered_map<std::string_view, StopPtr> name_stop_;
+		// Interned names: views point into the names stored in buses_ and stops_.
+		std::unordered_map<std::string_view, BusId> name_bus_;
+		std::unordered_map<std::string_view, StopId> name_stop_;
 
-		std::unordered_map<std::pair<StopPtr, StopPtr>, int, StopHasher, StopPtrEqual> dist_betw_stops_;
+		MapDistance dist_betw_stops_;
 	};
 }
 
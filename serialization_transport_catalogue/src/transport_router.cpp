@@ -2,10 +2,12 @@
 
 namespace transport_router
 {
-	TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& tc, const domain::RoutingSettings& settings)
+	TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& tc, const domain::RoutingSettings& settings
+		, size_t thread_count)
 		: transport_catalogue_(tc)
 		, routing_settings_(settings)
-		, graph_(tc.GetStop().size())
+		, thread_count_(thread_count)
+		, graph_(tc.GetStopCount())
 	{		
 		CreateGraph();
 	}
@@ -15,76 +17,346 @@ namespace transport_router
 		, StopsVertexId&& stops_vertex_id
 		, Vertices&& vertices_info
 		, std::vector<EdgeInfo>&& adges_info
-		, std::vector<graph::Edge<double>>&& edges
-		, std::vector<std::vector<size_t>>&& incidence_lists
-		, graph::Router<double>::RoutesInternalData&& data)
+		, BusGraph&& graph
+		, RouterData&& router_data)
 		: transport_catalogue_(transport_catalogue), routing_settings_(routing_settings)
+		, graph_(std::move(graph))
 	{
-		graph_(std::move(edges), std::move(incidence_lists));
-		stops_vertex_id_ = { stops_vertex_id.begin(), stops_vertex_id.end() };
-		vertices_info_ = { vertices_info.begin(), vertices_info.end() };
-		edges_info_ = { adges_info.begin(), adges_info.end() };
-		static  Router router(graph_, std::move(data));
-		router_ = std::make_unique<Router>(router);
+		stops_vertex_id_ = std::move(stops_vertex_id);
+		vertices_info_ = std::move(vertices_info);
+		edges_info_ = std::move(adges_info);
+		CreateRouter(std::move(router_data));
 	}
 
-	inline void TransportRouter::CreateGraph() noexcept
+	inline void TransportRouter::CreateGraph()
 	{
+		if (routing_settings_.graph_model == domain::GraphModel::SPLIT)
+		{
+			CreateSplitGraph();
+		}
+		else
+		{
+			for (const auto& bus : transport_catalogue_.GetRoute())
+			{
+				const auto& stops = bus.stops;
+				FillGraph(stops.begin(), stops.end(), bus.name);
+			}
+		}
+		CreateRouter({});
+	}
+
+	void TransportRouter::CreateSplitGraph()
+	{
+		size_t bus_stop_count = 0;
+		for (const auto& bus : transport_catalogue_.GetRoute())
+		{
+			for (const auto& stop : bus.stops)
+			{
+				MakeVertexId(*stop);
+			}
+			bus_stop_count += bus.stops.size();
+		}
+		graph_ = BusGraph(vertices_info_.size() + bus_stop_count);
+		vertices_info_.reserve(graph_.GetVertexCount());
+
+		const double wait_time = static_cast<double>(routing_settings_.bus_wait_time);
 		for (const auto& bus : transport_catalogue_.GetRoute())
 		{
 			const auto& stops = bus.stops;
-			FillGraph(stops.begin(), stops.end(), bus.name);
+			for (size_t i = 0; i < stops.size(); ++i)
+			{
+				const graph::VertexId stop_vertex = stops_vertex_id_.at(stops[i]->name);
+				const graph::VertexId bus_vertex = vertices_info_.size();
+				vertices_info_.push_back(stops[i]->name);
+				if (i != 0)
+				{
+					graph_.AddEdge({ bus_vertex, stop_vertex, 0. });
+					edges_info_.push_back(BusEdgeInfo{ bus.name, 0, edges_info_.size() });
+				}
+				if (i + 1 != stops.size())
+				{
+					graph_.AddEdge({ stop_vertex, bus_vertex, wait_time });
+					edges_info_.push_back(WaitAdgeInfo{});
+					graph_.AddEdge({ bus_vertex, bus_vertex + 1, CalculateWeightEdge(*stops[i], *stops[i + 1]) });
+					edges_info_.push_back(BusEdgeInfo{ bus.name, 1, edges_info_.size() });
+				}
+			}
+		}
+	}
+
+	void TransportRouter::CreateRouter(RouterData&& router_data)
+	{
+		if (routing_settings_.route_cache_size != 0)
+		{
+			route_cache_ = std::make_unique<RouteCache>(routing_settings_.route_cache_size);
+		}
+		HierarchyData& hierarchy = router_data.hierarchy;
+		switch (routing_settings_.router_mode)
+		{
+		case domain::RouterMode::ALL_PAIRS:
+			if (router_data.mapped_routes)
+			{
+				router_.emplace<Router>(graph_, router_data.mapped_routes, router_data.mapped_route_count
+					, GetRouteSourceCount());
+			}
+			else if (router_data.routes.empty())
+			{
+				thread_pool::ThreadPool pool(thread_count_);
+				if (routing_settings_.graph_model == domain::GraphModel::SPLIT)
+				{
+					router_.emplace<Router>(graph_, GetRouteSourceCount(), pool);
+				}
+				else
+				{
+					router_.emplace<Router>(graph_, pool);
+				}
+			}
+			else
+			{
+				router_.emplace<Router>(graph_, std::move(router_data.routes), GetRouteSourceCount());
+			}
+			break;
+		case domain::RouterMode::DIJKSTRA:
+			router_.emplace<DijkstraRouter>(graph_);
+			break;
+		case domain::RouterMode::CONTRACTION_HIERARCHY:
+			if (hierarchy.edges.empty())
+			{
+				router_.emplace<Hierarchy>(graph_);
+			}
+			else
+			{
+				router_.emplace<Hierarchy>(graph_, std::move(hierarchy.edges)
+					, std::move(hierarchy.upward), std::move(hierarchy.downward));
+			}
+			break;
 		}
-		static  Router router(graph_);
-		router_ = std::make_unique<Router>(router);
+	}
+
+	size_t TransportRouter::GetRouteSourceCount() const noexcept
+	{
+		// Stop vertices of the split graph come first, routes never start at the vertices of buses
+		return routing_settings_.graph_model == domain::GraphModel::SPLIT ? stops_vertex_id_.size() : graph_.GetVertexCount();
+	}
+
+	std::optional<double> TransportRouter::BuildRoute(graph::VertexId from, graph::VertexId to
+		, std::vector<graph::EdgeId>& edges) const
+	{
+		return std::visit([from, to, &edges](const auto& router) -> std::optional<double>
+			{
+				using RouterType = std::decay_t<decltype(router)>;
+				if constexpr (std::is_same_v<RouterType, std::monostate>)
+				{
+					return std::nullopt;
+				}
+				else if constexpr (std::is_same_v<RouterType, Router>)
+				{
+					return router.BuildRoute(from, to, edges);
+				}
+				else
+				{
+					// The on-demand routers allocate their search state anyway
+					auto route = router.BuildRoute(from, to);
+					if (!route)
+					{
+						return std::nullopt;
+					}
+					edges.assign(route->edges.begin(), route->edges.end());
+					return route->weight;
+				}
+			}, router_);
 	}
 	
 	std::optional<transport_router::TransportRouter::RouteInfo> TransportRouter::FindRoute(const std::string& stop1, const std::string& stop2) const noexcept
 	{
-		using namespace graph;
-		if (std::count(vertices_info_.begin(), vertices_info_.end(), stop1) == 0
-			|| std::count(vertices_info_.begin(), vertices_info_.end(), stop2) == 0)
+		const std::optional<graph::VertexId> start = FindStopVertex(stop1);
+		const std::optional<graph::VertexId> finish = FindStopVertex(stop2);
+		if (!start || !finish)
 		{
 			return {};
 		}
-		VertexId start = stops_vertex_id_.at(stop1);
-		VertexId finish = stops_vertex_id_.at(stop2);
-		const auto& info_route = router_->BuildRoute(start, finish);
-		if (info_route)
+		return FindRoute(*start, *finish);
+	}
+
+	std::optional<TransportRouter::RouteInfo> TransportRouter::FindRoute(graph::VertexId from, graph::VertexId to) const noexcept
+	{
+		RouteView route;
+		if (!FindRoute(from, to, route))
 		{
-			RouteInfo result;
-			result.total_time = info_route->weight;
-			const std::vector<EdgeId>& edges = info_route->edges;
-			for (const auto& edge : edges)
+			return {};
+		}
+		RouteInfo result;
+		result.total_time = route.total_time;
+		result.items.reserve(route.legs.size());
+		for (const RouteView::Leg& leg : route.legs)
+		{
+			if (const auto* wait = std::get_if<RouteView::WaitLeg>(&leg))
+			{
+				result.items.push_back(RouteInfo::WaitItem{ std::string(wait->stop_name), wait->time });
+			}
+			else
 			{
-				RouteInfo::WaitItem wait_item = CreateWaitItem(edge);				
-				result.items.push_back(std::move(wait_item));				
-				result.items.push_back(std::move(CreateBusItem(edge, wait_item.time)));
+				const auto& bus = std::get<RouteView::BusLeg>(leg);
+				result.items.push_back(RouteInfo::BusItem{ std::string(bus.bus_name), bus.time, bus.span_count });
 			}
-			return result;
 		}
-		else
+		return result;
+	}
+
+	bool TransportRouter::FindRoute(graph::VertexId from, graph::VertexId to, RouteView& route) const noexcept
+	{
+		route.total_time = 0.;
+		route.legs.clear();
+		// Stops get vertex ids from zero up in the order they are met on the buses
+		if (from >= stops_vertex_id_.size() || to >= stops_vertex_id_.size())
 		{
-			return {};
+			return false;
 		}
+		if (!route_cache_)
+		{
+			return BuildRouteLegs(from, to, route);
+		}
+
+		const size_t key = from * stops_vertex_id_.size() + to;
+		bool found = false;
+		const bool cached = route_cache_->Read(key, [&route, &found](const CachedRoute& cached_route)
+			{
+				found = cached_route.found;
+				route.total_time = cached_route.total_time;
+				route.legs = cached_route.legs;
+			});
+		if (cached)
+		{
+			return found;
+		}
+		found = BuildRouteLegs(from, to, route);
+		route_cache_->Insert(key, CachedRoute{ found, route.total_time, route.legs });
+		return found;
 	}
 
-	inline TransportRouter::RouteInfo::WaitItem TransportRouter::CreateWaitItem(const graph::EdgeId& edge) const noexcept
+	bool TransportRouter::BuildRouteLegs(graph::VertexId from, graph::VertexId to, RouteView& route) const
 	{
-		TransportRouter::RouteInfo::WaitItem wait_item;
-		wait_item.stop_name = vertices_info_.at(graph_.GetEdge(edge).from);
-		wait_item.time = routing_settings_.bus_wait_time;
-		return wait_item;
+		if (!BuildRoute(from, to, route.edges))
+		{
+			return false;
+		}
+		if (routing_settings_.graph_model == domain::GraphModel::SPLIT)
+		{
+			AddSplitRouteLegs(route);
+			return true;
+		}
+		// The routers add the weights up in different orders, the total is summed along the route
+		for (const graph::EdgeId edge : route.edges)
+		{
+			const RouteView::WaitLeg wait_leg = CreateWaitLeg(edge);
+			route.legs.push_back(wait_leg);
+			route.legs.push_back(CreateBusLeg(edge, wait_leg.time));
+			route.total_time += graph_.GetEdgeUnchecked(edge).weight;
+		}
+		return true;
 	}
 
-	inline TransportRouter::RouteInfo::BusItem TransportRouter::CreateBusItem(const graph::EdgeId& edge , double time) const noexcept
+	void TransportRouter::AddSplitRouteLegs(RouteView& route) const
 	{
-		RouteInfo::BusItem bus_item;
-		BusEdgeInfo bus_info = std::get<BusEdgeInfo>(edges_info_.at(edge));
-		bus_item.bus_name = bus_info.bus_name;
-		bus_item.span_count = bus_info.span_count;
-		bus_item.time = graph_.GetEdge(edge).weight -time;
-		return bus_item;
+		// A leg weighs the wait plus the rides added one by one, as an edge of the complete graph
+		RouteView::BusLeg bus_leg;
+		double leg_weight = 0.;
+		std::string_view from_stop;
+		for (const graph::EdgeId edge : route.edges)
+		{
+			const graph::Edge<double>& graph_edge = graph_.GetEdgeUnchecked(edge);
+			const auto* bus_info = std::get_if<BusEdgeInfo>(&edges_info_[edge]);
+			if (!bus_info)
+			{
+				const RouteView::WaitLeg wait_leg = CreateWaitLeg(edge);
+				route.legs.push_back(wait_leg);
+				bus_leg = {};
+				leg_weight = graph_edge.weight;
+				from_stop = wait_leg.stop_name;
+			}
+			else if (bus_info->span_count != 0)
+			{
+				bus_leg.bus_name = bus_info->bus_name;
+				leg_weight += graph_edge.weight;
+				++bus_leg.span_count;
+			}
+			else
+			{
+				bus_leg.time = leg_weight - static_cast<double>(routing_settings_.bus_wait_time);
+				TakeFirstBus(from_stop, vertices_info_[graph_edge.to], leg_weight, bus_leg);
+				route.legs.push_back(bus_leg);
+				route.total_time += leg_weight;
+			}
+		}
+	}
+
+	void TransportRouter::TakeFirstBus(std::string_view from, std::string_view to, double leg_weight
+		, RouteView::BusLeg& bus_leg) const
+	{
+		const std::optional<transport_catalogue::StopId> from_id = transport_catalogue_.FindStopId(from);
+		const std::optional<transport_catalogue::StopId> to_id = transport_catalogue_.FindStopId(to);
+		std::optional<transport_catalogue::BusId> first_bus = transport_catalogue_.FindBusId(bus_leg.bus_name);
+		if (!from_id || !to_id || !first_bus)
+		{
+			return;
+		}
+		// The complete graph has an edge for every bus, every stop of it and every span count,
+		// in this order, and its routers keep the first of the edges of the same weight.
+		int first_span_count = bus_leg.span_count;
+		for (const transport_catalogue::BusId bus : transport_catalogue_.GetBusesByStop(*from_id))
+		{
+			if (bus > *first_bus)
+			{
+				continue;
+			}
+			const auto& stops = transport_catalogue_.GetBusById(bus).stops;
+			std::optional<int> span_count;
+			for (size_t begin = 0; begin + 1 < stops.size() && !span_count; ++begin)
+			{
+				if (stops[begin]->id != *from_id)
+				{
+					continue;
+				}
+				double weight = static_cast<double>(routing_settings_.bus_wait_time);
+				for (size_t end = begin + 1; end < stops.size() && weight <= leg_weight; ++end)
+				{
+					weight += CalculateWeightEdge(*stops[end - 1], *stops[end]);
+					if (stops[end]->id == *to_id && weight == leg_weight)
+					{
+						span_count = static_cast<int>(end - begin);
+						break;
+					}
+				}
+			}
+			// The first stop of a bus found first, so the same bus never gives a later edge
+			if (span_count)
+			{
+				first_bus = bus;
+				first_span_count = *span_count;
+			}
+		}
+		bus_leg.bus_name = transport_catalogue_.GetBusById(*first_bus).name;
+		bus_leg.span_count = first_span_count;
+	}
+
+	std::optional<graph::VertexId> TransportRouter::FindStopVertex(const std::string& stop) const noexcept
+	{
+		if (const auto it = stops_vertex_id_.find(stop); it != stops_vertex_id_.end())
+		{
+			return it->second;
+		}
+		return std::nullopt;
+	}
+
+	inline TransportRouter::RouteView::WaitLeg TransportRouter::CreateWaitLeg(graph::EdgeId edge) const noexcept
+	{
+		return { vertices_info_[graph_.GetEdgeUnchecked(edge).from], static_cast<double>(routing_settings_.bus_wait_time) };
+	}
+
+	inline TransportRouter::RouteView::BusLeg TransportRouter::CreateBusLeg(graph::EdgeId edge, double time) const noexcept
+	{
+		const BusEdgeInfo& bus_info = std::get<BusEdgeInfo>(edges_info_[edge]);
+		return { bus_info.bus_name, graph_.GetEdgeUnchecked(edge).weight - time, static_cast<int>(bus_info.span_count) };
 	}
 
 	TransportRouter::StopsVertexId TransportRouter::GetStopVertexId() const noexcept
@@ -107,26 +379,43 @@ namespace transport_router
 		return graph_;
 	}
 
-	TransportRouter::Router TransportRouter::GetRouter() const noexcept
+	const TransportRouter::Router* TransportRouter::GetRouter() const noexcept
+	{
+		return std::get_if<Router>(&router_);
+	}
+
+	const TransportRouter::Hierarchy* TransportRouter::GetHierarchy() const noexcept
+	{
+		return std::get_if<Hierarchy>(&router_);
+	}
+
+	domain::RouterMode TransportRouter::GetRouterMode() const noexcept
 	{
-		return *router_;
-	}	
+		return routing_settings_.router_mode;
+	}
+
+	std::optional<lru_cache::CacheStats> TransportRouter::GetRouteCacheStats() const
+	{
+		if (!route_cache_)
+		{
+			return std::nullopt;
+		}
+		return route_cache_->GetStats();
+	}
 
 	inline graph::VertexId TransportRouter::MakeVertexId(const transport_catalogue::Stop& stop) noexcept
 	{
-		using namespace graph;
-		if (stops_vertex_id_.count(stop.name) != 0)
+		const auto [it, inserted] = stops_vertex_id_.try_emplace(stop.name, stops_vertex_id_.size());
+		if (inserted)
 		{
-			return stops_vertex_id_.at(stop.name);
+			vertices_info_.push_back(stop.name);
 		}
-		stops_vertex_id_[stop.name] = {};
-		stops_vertex_id_[stop.name] = stops_vertex_id_.size() - 1;
-		return stops_vertex_id_[stop.name];
+		return it->second;
 	}
 
 	double TransportRouter::CalculateWeightEdge(const transport_catalogue::Stop& from, const transport_catalogue::Stop& to) const noexcept
 	{
-		return  60.0 * transport_catalogue_.GetDistanceBetweenStops(from, to) / (1000.0 * routing_settings_.bus_velocity);
+		return  60.0 * transport_catalogue_.FindDistanceBetweenStops(from.id, to.id) / (1000.0 * routing_settings_.bus_velocity);
 	}
 
 }//namespace transport_router
\ No newline at end of file
@@ -1,11 +1,15 @@
 #pragma once
 #include "graph.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "contraction_hierarchy.h"
 #include "domain.h"
+#include "lru_cache.h"
 #include "transport_catalogue.h"
 
 #include <variant>
 #include <memory>
+#include <string_view>
 #include <unordered_map>
 #include <cmath>
 
@@ -17,6 +21,9 @@ namespace transport_router
 		
 		using BusGraph = graph::DirectedWeightedGraph<double>;
 		using Router = graph::Router<double>;
+		using DijkstraRouter = graph::DijkstraRouter<double>;
+		using Hierarchy = graph::ContractionHierarchy<double>;
+		using AnyRouter = std::variant<std::monostate, Router, DijkstraRouter, Hierarchy>;
 		using StopName = std::string;
 		using StopsVertexId = std::unordered_map<StopName, graph::VertexId>;
 		using Vertices = std::vector<StopName>;
@@ -26,13 +33,30 @@ namespace transport_router
 		{
 			std::string stop_name;
 		};
+		// bus_name points to the name kept by the catalogue or by the mapped base file.
 		struct BusEdgeInfo
 		{
-			std::string bus_name;
+			std::string_view bus_name;
 			size_t span_count = 0;
 			size_t number_edge = 0;
 		};
 
+		struct HierarchyData
+		{
+			std::vector<Hierarchy::HierarchyEdge> edges;
+			Hierarchy::SearchGraph upward;
+			Hierarchy::SearchGraph downward;
+		};
+
+		// Precomputed data of the selected router read from the base.
+		struct RouterData
+		{
+			Router::RoutesInternalData routes;
+			const Router::RouteInternalData* mapped_routes = nullptr;
+			size_t mapped_route_count = 0;
+			HierarchyData hierarchy;
+		};
+
 		struct WaitAdgeInfo {};
 		using EdgeInfo = std::variant<BusEdgeInfo, WaitAdgeInfo>;
 
@@ -58,23 +82,60 @@ namespace transport_router
 			std::vector<Item> items;
 		};
 
+		// Route whose legs refer to the names kept by the router, valid while the router is.
+		// FindRoute fills it in place, so a view reused for many routes stops allocating
+		// once it has grown to the longest of them.
+		struct RouteView
+		{
+			double total_time = 0.;
+
+			struct BusLeg
+			{
+				std::string_view bus_name;
+				double time = 0.;
+				int span_count = 0;
+			};
+
+			struct WaitLeg
+			{
+				std::string_view stop_name;
+				double time = 0.;
+			};
+
+			using Leg = std::variant<BusLeg, WaitLeg>;
+
+			std::vector<Leg> legs;
+			// Edges of the route in the graph, scratch space of FindRoute
+			std::vector<graph::EdgeId> edges;
+		};
+
+		// thread_count is the number of threads building the all-pairs route table,
+		// 0 means one per hardware core.
 		explicit TransportRouter(const transport_catalogue::TransportCatalogue& tc
-			, const domain::RoutingSettings& settings);		
+			, const domain::RoutingSettings& settings, size_t thread_count = 1);		
 		
 		explicit TransportRouter(const transport_catalogue::TransportCatalogue& transport_catalogue
 			, domain::RoutingSettings&& routing_settings
 			, StopsVertexId&& stops_vertex_id, Vertices&& vertices_info
-			, std::vector<EdgeInfo>&& adges_info, std::vector<graph::Edge<double>>&& edges
-			, std::vector<std::vector<size_t>>&& incidence_lists
-			, graph::Router<double>::RoutesInternalData&& data);		
+			, std::vector<EdgeInfo>&& adges_info, BusGraph&& graph
+			, RouterData&& router_data);		
 
-		inline void CreateGraph() noexcept;
+		inline void CreateGraph();
 
 		std::optional<transport_router::TransportRouter::RouteInfo> FindRoute(const std::string& stop1, const std::string& stop2) const noexcept;	
 
-		inline RouteInfo::WaitItem CreateWaitItem(const graph::EdgeId& edge) const noexcept;
+		// Takes vertices of stops as returned by FindStopVertex, there is no route between other vertices.
+		std::optional<RouteInfo> FindRoute(graph::VertexId from, graph::VertexId to) const noexcept;
 
-		inline RouteInfo::BusItem CreateBusItem(const graph::EdgeId& edge, double time) const noexcept;
+		// Returns false if there is no route, the route is left empty then.
+		bool FindRoute(graph::VertexId from, graph::VertexId to, RouteView& route) const noexcept;
+
+		// Vertex the routes from and to the stop start at, none if no bus stops there.
+		std::optional<graph::VertexId> FindStopVertex(const std::string& stop) const noexcept;
+
+		inline RouteView::WaitLeg CreateWaitLeg(graph::EdgeId edge) const noexcept;
+
+		inline RouteView::BusLeg CreateBusLeg(graph::EdgeId edge, double time) const noexcept;
 
 		StopsVertexId GetStopVertexId() const noexcept;
 		
@@ -84,23 +145,68 @@ namespace transport_router
 		
 		BusGraph GetGraph() const noexcept;
 		
-		Router GetRouter() const noexcept;			
+		const Router* GetRouter() const noexcept;
+
+		const Hierarchy* GetHierarchy() const noexcept;
+
+		domain::RouterMode GetRouterMode() const noexcept;
+
+		// Hits and misses of the route cache, none if it is off.
+		std::optional<lru_cache::CacheStats> GetRouteCacheStats() const;
 
 	private:		
 
 		inline graph::VertexId MakeVertexId(const transport_catalogue::Stop& stop) noexcept;		
 
+		// Builds the graph of the split model: every stop has a vertex the routes start and end at,
+		// every stop of every bus has a vertex of its own. Boarding a bus is an edge weighing
+		// the wait time, riding to the next stop of the bus is an edge weighing the ride time and
+		// alighting is an edge of zero weight, so a bus of k stops gives O(k) edges.
+		void CreateSplitGraph();
+
+		// Turns the edges of a route in the split graph into legs: a wait leg for a boarding
+		// and a bus leg for the rides up to the next alighting. The times are summed in the
+		// order the complete model sums them, so both models give the same times.
+		void AddSplitRouteLegs(RouteView& route) const;
+
+		// Among the buses riding from one stop to the other with the same leg weight takes the
+		// first one in the catalogue, as the complete model does with its parallel edges.
+		void TakeFirstBus(std::string_view from, std::string_view to, double leg_weight
+			, RouteView::BusLeg& bus_leg) const;
+
+		// Finds the route and its legs bypassing the route cache.
+		bool BuildRouteLegs(graph::VertexId from, graph::VertexId to, RouteView& route) const;
+
+		void CreateRouter(RouterData&& router_data);
+
+		// Number of vertices the all-pairs route table has rows for.
+		size_t GetRouteSourceCount() const noexcept;
+
+		// Writes the edges of the route into edges and returns its weight.
+		std::optional<double> BuildRoute(graph::VertexId from, graph::VertexId to, std::vector<graph::EdgeId>& edges) const;
+
 		double CalculateWeightEdge(const transport_catalogue::Stop& from,
 			const transport_catalogue::Stop& to) const noexcept;		
 
 		template<class It>
-		void FillGraph(It begin, It end, const std::string& bus_name) noexcept;	
+		void FillGraph(It begin, It end, std::string_view bus_name) noexcept;	
 
 		
 		const transport_catalogue::TransportCatalogue& transport_catalogue_;
 		domain::RoutingSettings routing_settings_;
+		size_t thread_count_ = 1;
 		BusGraph graph_;
-		std::shared_ptr<Router> router_ = nullptr;
+		AnyRouter router_;
+
+		// Built routes by from * stop count + to, the legs only: found is false if there is no route
+		struct CachedRoute
+		{
+			bool found = false;
+			double total_time = 0.;
+			std::vector<RouteView::Leg> legs;
+		};
+		using RouteCache = lru_cache::LruCache<size_t, CachedRoute>;
+		std::unique_ptr<RouteCache> route_cache_;
 
 		StopsVertexId stops_vertex_id_;
 		Vertices vertices_info_;
@@ -108,34 +214,25 @@ namespace transport_router
 	};
 
 	template<class It>
-	inline void TransportRouter::FillGraph(It begin, It end, const std::string& bus_name) noexcept
+	inline void TransportRouter::FillGraph(It begin, It end, std::string_view bus_name) noexcept
 	{
+		const double wait_time = static_cast<double>(routing_settings_.bus_wait_time);
 		for (auto it_stop = begin; it_stop != end; ++it_stop)
 		{
 			graph::VertexId from = MakeVertexId(**it_stop);
-			graph_.AddEdge({ from, from, { static_cast<double>(routing_settings_.bus_wait_time)} });
-			const StopName& stop = (**it_stop).name;
-			if (!std::count(vertices_info_.begin(), vertices_info_.end(), stop))
-			{
-				vertices_info_.push_back(stop);
-			}
-			stops_vertex_id_[stop] = from;
+			graph_.AddEdge({ from, from, wait_time });
 			size_t span_count = 0;
 			const BusEdgeInfo bus_edge_info = { bus_name , span_count, edges_info_.size() };
 			edges_info_.push_back(std::move(bus_edge_info));
-			for (auto it = it_stop; it != end; ++it)
+			double minutes_to_route = wait_time;
+			for (auto it = it_stop; it + 1 != end; ++it)
 			{
-				if (it + 1 != end)
-				{
-					graph::VertexId to{};
-					double minutes_to_route = graph_.GetEdge(graph_.GetEdgeCount() - 1).weight;
-					to = MakeVertexId(**(it + 1));
-					minutes_to_route += CalculateWeightEdge(**it, **(it + 1));
-					graph_.AddEdge({ from, to, minutes_to_route });
-
-					const BusEdgeInfo bus_edge_info = { bus_name , ++span_count, edges_info_.size() };
-					edges_info_.push_back(bus_edge_info);
-				}
+				const graph::VertexId to = MakeVertexId(**(it + 1));
+				minutes_to_route += CalculateWeightEdge(**it, **(it + 1));
+				graph_.AddEdge({ from, to, minutes_to_route });
+
+				const BusEdgeInfo bus_edge_info = { bus_name , ++span_count, edges_info_.size() };
+				edges_info_.push_back(bus_edge_info);
 			}
 		}
 	}